@@ -1,20 +1,172 @@
 #include "Attr.h"
+#include "FileUtil.h"
+#include "RecentFiles.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QTimer>
+#include <QVariantMap>
+
+#include <algorithm>
+
+// Identifies a settings file
+static constexpr quint32 SETTINGS_MAGIC = 0x514E5354;
+// Version of the settings format; new keys do not need a new version
+static constexpr quint32 SETTINGS_VERSION = 1;
+// Delay before saving changed settings, so bursts of changes are saved once
+static constexpr int SAVE_DELAY = 500;
+// Settings file of older versions, in the working directory
+static const QString LEGACY_PATH{"QNotepad_Data"};
+
+/**
+ * @brief Provides the path of the settings file.
+ * @return The full file path.
+ */
+static QString settingsPath() {
+    return FileUtil::dataDir("settings") + "/settings.dat";
+}
+
+/**
+ * @brief Reads a setting, keeping the default if it is missing or invalid.
+ * @param map The stored settings.
+ * @param key The key of the setting.
+ * @param value Receives the setting.
+ */
+template <typename T>
+static void readValue(const QVariantMap &map, const QString &key, T &value) {
+    const auto it = map.constFind(key);
+    if (it != map.cend() && it->canConvert<T>()) {
+        value = it->value<T>();
+    }
+}
 
 void Attr::save() {
-    QFile file{"QNotepad_Data"};
-    if (!file.open(QFile::WriteOnly | QFile::Text)) {
+    // The pending save is done now
+    if (saveTimer) {
+        saveTimer->stop();
+    }
+
+    // Keep only the most recent paths, so the history cannot grow forever
+    if (recentPaths.size() > RecentFiles::MAX_COUNT) {
+        recentPaths.resize(RecentFiles::MAX_COUNT);
+    }
+
+    const QVariantMap map{
+        {"recentDir", recentDir},
+        {"recentPaths", recentPaths},
+        {"findTarget", findTarget},
+        {"replaceTarget", replaceTarget},
+        {"matchCase", matchCase},
+        {"matchWholeWord", matchWholeWord},
+        {"showLine", showLine},
+        {"showStatus", showStatus},
+        {"wordWrap", wordWrap},
+        {"zoom", zoom},
+        {"editorFont", editorFont},
+        {"lang", static_cast<int>(lang)},
+        {"resident", resident},
+        {"residentTimeout", residentTimeout},
+        {"memoryBudget", memoryBudget},
+        {"layoutBudget", layoutBudget},
+        {"largeFileSize", largeFileSize},
+    };
+
+    // Replace the file in one step, so a crash never leaves half of it
+    QSaveFile file{settingsPath()};
+    if (!file.open(QSaveFile::WriteOnly)) {
         return;
     }
 
     QDataStream out{&file};
-    out << recentDir << recentPaths << findTarget << replaceTarget
-        << matchCase << matchWholeWord << showLine << showStatus
-        << wordWrap << zoom << editorFont << lang;
-    file.close();
+    out.setVersion(QDataStream::Qt_6_0);
+    out << SETTINGS_MAGIC << SETTINGS_VERSION << map;
+    if (out.status() == QDataStream::Ok) {
+        file.commit();
+    }
 }
 
 bool Attr::load() {
-    QFile file{"QNotepad_Data"};
+    QFile file{settingsPath()};
+    if (!file.open(QFile::ReadOnly)) {
+        // Move the settings of older versions to the new location
+        if (!loadLegacy()) {
+            return false;
+        }
+        save();
+        QFile::remove(LEGACY_PATH);
+        return true;
+    }
+
+    // Map the file, so it is read without copying it first
+    const qint64 size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data) {
+        return false;
+    }
+    const QByteArray bytes =
+        QByteArray::fromRawData(reinterpret_cast<const char *>(data), size);
+
+    QDataStream in{bytes};
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != SETTINGS_MAGIC || version > SETTINGS_VERSION) {
+        return false;
+    }
+    QVariantMap map;
+    in >> map;
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    readValue(map, "recentDir", recentDir);
+    readValue(map, "recentPaths", recentPaths);
+    readValue(map, "findTarget", findTarget);
+    readValue(map, "replaceTarget", replaceTarget);
+    readValue(map, "matchCase", matchCase);
+    readValue(map, "matchWholeWord", matchWholeWord);
+    readValue(map, "showLine", showLine);
+    readValue(map, "showStatus", showStatus);
+    readValue(map, "wordWrap", wordWrap);
+    readValue(map, "zoom", zoom);
+    readValue(map, "editorFont", editorFont);
+    readValue(map, "resident", resident);
+    readValue(map, "residentTimeout", residentTimeout);
+    readValue(map, "memoryBudget", memoryBudget);
+    readValue(map, "layoutBudget", layoutBudget);
+    readValue(map, "largeFileSize", largeFileSize);
+
+    // Ignore languages that are no longer supported
+    int langIndex = static_cast<int>(lang);
+    readValue(map, "lang", langIndex);
+    if (LangUtil::getLanguages().contains(static_cast<Lang>(langIndex))) {
+        lang = static_cast<Lang>(langIndex);
+    }
+    return true;
+}
+
+void Attr::changed() {
+    if (!saveTimer) {
+        saveTimer = new QTimer{QCoreApplication::instance()};
+        saveTimer->setSingleShot(true);
+        saveTimer->setInterval(SAVE_DELAY);
+        QObject::connect(saveTimer, &QTimer::timeout, saveTimer, [] {
+            get().save();
+        });
+    }
+    saveTimer->start();
+}
+
+Attr &Attr::get() {
+    static Attr attr;
+    return attr;
+}
+
+bool Attr::loadLegacy() {
+    // Older versions wrote the binary stream in text mode,
+    // so it is read back in text mode
+    QFile file{LEGACY_PATH};
     if (!file.open(QFile::ReadOnly | QFile::Text)) {
         return false;
     }
@@ -23,11 +175,17 @@ bool Attr::load() {
     in >> recentDir >> recentPaths >> findTarget >> replaceTarget
        >> matchCase >> matchWholeWord >> showLine >> showStatus
        >> wordWrap >> zoom >> editorFont >> lang;
+    // Older versions listed the most recent file last
+    std::reverse(recentPaths.begin(), recentPaths.end());
+
+    // Keep the defaults of attributes missing from older data
+    bool newResident;
+    int newResidentTimeout;
+    in >> newResident >> newResidentTimeout;
+    if (in.status() == QDataStream::Ok) {
+        resident = newResident;
+        residentTimeout = newResidentTimeout;
+    }
     file.close();
     return true;
 }
-
-Attr &Attr::get() {
-    static Attr attr;
-    return attr;
-}
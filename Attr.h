@@ -4,6 +4,7 @@
 
 #include <QDir>
 #include <QFont>
+#include <QTimer>
 #include <QtGui/qscreen.h>
 #include <QtWidgets/qapplication.h>
 
@@ -14,7 +15,7 @@ class Attr {
 public:
     /// Directory that the most recent file is opened or saved to.
     QString recentDir{QDir::homePath()};
-    /// Paths of recently opened files.
+    /// Paths of recently opened files, the most recent first.
     QStringList recentPaths;
     /// Text snippet to be searched.
     QString findTarget;
@@ -41,16 +42,35 @@ public:
 #endif
     /// Display language.
     Lang lang{Lang::ENGLISH};
+    /// Whether to keep running in the background after the last window closes.
+    bool resident{false};
+    /// Minutes to stay idle in the background before quitting, or 0 for never.
+    int residentTimeout{60};
+    /// Megabytes of documents kept in memory before background windows
+    /// hibernate, or 0 for no limit.
+    int memoryBudget{1024};
+    /// Megabytes of block layouts cached by each editor, or 0 for no limit.
+    int layoutBudget{64};
+    /// Megabytes from which files open in the large file view,
+    /// or 0 to always open them in the editor.
+    int largeFileSize{0};
 
     /**
-     * @brief Saves all attributes to the program folder.
+     * @brief Saves all attributes to the program data folder.
+     * @note The file is replaced atomically.
      */
     void save();
     /**
-     * @brief Loads all attributes from the program folder.
+     * @brief Loads all attributes from the program data folder.
+     * @note Settings of older versions are migrated on the first load.
      * @return true if successful; false otherwise.
      */
     bool load();
+    /**
+     * @brief Schedules a save after an attribute changes.
+     * @note Changes in quick succession are saved once.
+     */
+    void changed();
 
     /**
      * @brief Provides access to the singleton instance.
@@ -61,4 +81,13 @@ public:
 private:
     // Private constructor to prevent external instantiation
     Attr() = default;
+
+    // Delays saving after a change
+    QTimer *saveTimer{nullptr};
+
+    /**
+     * @brief Loads the attributes saved by older versions.
+     * @return true if successful; false otherwise.
+     */
+    bool loadLegacy();
 };
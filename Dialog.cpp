@@ -11,9 +11,14 @@
 #include <QTextBrowser>
 #include <QMessageBox>
 #include <QDesktopServices>
-
-Dialog::Dialog(MainWindow *win)
-    : QDialog{win}, win{win}, editor{win->getEditor()} {
+#include <QFileInfo>
+#include <QLocale>
+#include <QTextCursor>
+#include <QTimer>
+
+Dialog::Dialog(QWidget *parent)
+    : QDialog{parent}, win{qobject_cast<MainWindow *>(parent)},
+      editor{win ? win->getEditor() : nullptr} {
     // Free memory on close
     setAttribute(Qt::WA_DeleteOnClose);
 
@@ -49,6 +54,7 @@ FindDialog::FindDialog(MainWindow *win) : Dialog{win} {
 
         // Update the text snippet to search for
         Attr::get().findTarget = text;
+        Attr::get().changed();
         highlighter->updateTarget();
     });
     mainLayout->addWidget(findField, 0, 0);
@@ -99,6 +105,7 @@ void FindDialog::newOption(const QString &text, bool &state) {
     connect(box, &QCheckBox::checkStateChanged, this, [this, &state] (bool newState) {
         // Update the preference
         state = newState;
+        Attr::get().changed();
         // Search for the text snippet again
         highlighter->updateTarget();
     });
@@ -118,6 +125,7 @@ ReplaceDialog::ReplaceDialog(MainWindow *win) : FindDialog{win} {
     connect(replaceField, &QLineEdit::textChanged, this, [] (const QString &text) {
         // Update the replacement
         Attr::get().replaceTarget = text;
+        Attr::get().changed();
     });
     mainLayout->addWidget(replaceField, 1, 0);
 
@@ -148,9 +156,11 @@ GoToDialog::GoToDialog(MainWindow *win) : Dialog(win) {
     lnField = new QSpinBox{this};
     // Ensure the value is within the line counts
     lnField->setMinimum(1);
-    lnField->setMaximum(editor->document()->blockCount());
+    lnField->setMaximum(editor->lineCount());
     // Set to the current line number
-    lnField->setValue(editor->textCursor().blockNumber() + 1);
+    int line, column;
+    editor->cursorPos(line, column);
+    lnField->setValue(line);
     mainLayout->addWidget(new QLabel{tr("Line:")}, 0, 0);
     mainLayout->addWidget(lnField, 0, 1);
 
@@ -174,7 +184,176 @@ void GoToDialog::go() {
     close();
 }
 
-AboutDialog::AboutDialog(MainWindow *win) : Dialog{win} {
+HistoryDialog::HistoryDialog(MainWindow *win) : Dialog{win} {
+    setWindowTitle(tr("History") + " - " + QFileInfo{win->getFilePath()}.fileName());
+
+    versionList = new QListWidget{this};
+    versionList->setFixedWidth(250);
+    versions = History::versions(win->getFilePath());
+    for (const auto &version : std::as_const(versions)) {
+        versionList->addItem(QLocale{}.toString(version.time, QLocale::ShortFormat) +
+                             "  (" + QLocale{}.formattedDataSize(version.size) + ")");
+    }
+    mainLayout->addWidget(versionList, 0, 0, 1, 2);
+
+    diffView = new QPlainTextEdit{this};
+    diffView->setReadOnly(true);
+    diffView->setLineWrapMode(QPlainTextEdit::NoWrap);
+    diffView->setFont(Attr::get().editorFont);
+    diffView->setFixedSize(600, 400);
+    diffView->setPlaceholderText(versions.isEmpty() ? tr("No saved versions.") : "");
+    mainLayout->addWidget(diffView, 0, 2);
+
+    diffButton = new QPushButton{tr("Compare"), this};
+    diffButton->setEnabled(false);
+    connect(diffButton, &QPushButton::clicked, this, &HistoryDialog::showDiff);
+    mainLayout->addWidget(diffButton, 1, 0);
+
+    restoreButton = new QPushButton{tr("Restore"), this};
+    restoreButton->setEnabled(false);
+    connect(restoreButton, &QPushButton::clicked, this, &HistoryDialog::restore);
+    mainLayout->addWidget(restoreButton, 1, 1);
+
+    // Enable the buttons once a version is selected
+    connect(versionList, &QListWidget::currentRowChanged, this, [this] (int row) {
+        diffButton->setEnabled(row >= 0);
+        restoreButton->setEnabled(row >= 0);
+    });
+}
+
+QString HistoryDialog::selectedText() const {
+    const auto &version = versions.at(versionList->currentRow());
+    return QString::fromUtf8(History::load(win->getFilePath(), version.id));
+}
+
+void HistoryDialog::showDiff() {
+    const QString &changes = diff(selectedText(), Editor::fileText(editor->document()));
+    diffView->setPlainText(changes.isEmpty() ? tr("No differences.") : changes);
+}
+
+void HistoryDialog::restore() {
+    const auto &ans = QMessageBox::question(
+        this, tr("Confirm Restoring"),
+        tr("Do you want to replace the editor content with this version?"));
+
+    if (ans == QMessageBox::Yes) {
+        // Keep the restoration undoable
+        QTextCursor cursor{editor->document()};
+        cursor.select(QTextCursor::Document);
+        cursor.insertText(selectedText());
+        close();
+    }
+}
+
+QString HistoryDialog::diff(const QString &before, const QString &after) {
+    const QStringList &a = before.split('\n');
+    const QStringList &b = after.split('\n');
+
+    // Skip the common lines at both ends
+    qsizetype start = 0;
+    while (start < a.size() && start < b.size() && a[start] == b[start]) {
+        ++start;
+    }
+    qsizetype endA = a.size(), endB = b.size();
+    while (endA > start && endB > start && a[endA - 1] == b[endB - 1]) {
+        --endA;
+        --endB;
+    }
+
+    const qsizetype n = endA - start, m = endB - start;
+    QStringList lines;
+    if (n == 0 && m == 0) {
+        return "";
+    }
+    lines.append(QString{"@@ %0 @@"}.arg(start + 1));
+
+    // Match the remaining lines by their longest common subsequence,
+    // unless the table would be too large
+    if (n * m > 4'000'000) {
+        for (qsizetype i = start; i < endA; ++i) {
+            lines.append("- " + a[i]);
+        }
+        for (qsizetype j = start; j < endB; ++j) {
+            lines.append("+ " + b[j]);
+        }
+        return lines.join('\n');
+    }
+
+    QList<int> lcs((n + 1) * (m + 1), 0);
+    for (qsizetype i = n - 1; i >= 0; --i) {
+        for (qsizetype j = m - 1; j >= 0; --j) {
+            lcs[i * (m + 1) + j] = a[start + i] == b[start + j]
+                ? lcs[(i + 1) * (m + 1) + j + 1] + 1
+                : qMax(lcs[(i + 1) * (m + 1) + j], lcs[i * (m + 1) + j + 1]);
+        }
+    }
+
+    qsizetype i = 0, j = 0;
+    while (i < n || j < m) {
+        if (i < n && j < m && a[start + i] == b[start + j]) {
+            lines.append("  " + a[start + i]);
+            ++i;
+            ++j;
+        } else if (j < m && (i == n || lcs[i * (m + 1) + j + 1] >= lcs[(i + 1) * (m + 1) + j])) {
+            lines.append("+ " + b[start + j]);
+            ++j;
+        } else {
+            lines.append("- " + a[start + i]);
+            ++i;
+        }
+    }
+
+    return lines.join('\n');
+}
+
+DiagnosticsDialog::DiagnosticsDialog(MainWindow *win) : Dialog{win} {
+    setWindowTitle(tr("Diagnostics"));
+
+    // Leave room for the numbers to grow while the dialog is open
+    infoLabel = new QLabel{this};
+    infoLabel->setMinimumWidth(420);
+    infoLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    mainLayout->addWidget(infoLabel, 0, 0);
+
+    // Close the dialog on click
+    auto okButton = new QPushButton{tr("OK"), this};
+    okButton->setDefault(true);
+    connect(okButton, &QPushButton::clicked, this, &Dialog::close);
+    mainLayout->addWidget(okButton, 1, 0, Qt::AlignCenter);
+
+    // Follow the statistics while the document is scrolled
+    auto timer = new QTimer{this};
+    connect(timer, &QTimer::timeout, this, &DiagnosticsDialog::updateInfo);
+    timer->start(500);
+    updateInfo();
+}
+
+void DiagnosticsDialog::updateInfo() {
+    // Ask for the editor each time, as the focused pane may change
+    const Editor *current = win->getEditor();
+    const auto &stats = current->layoutStats();
+    const QLocale locale;
+
+    const quint64 shown = stats.hits + stats.misses;
+    const QString &hitRate = shown > 0
+        ? locale.toString(100.0 * stats.hits / shown, 'f', 1) + "%" : tr("none");
+    const int budget = Attr::get().layoutBudget;
+    const QString &limit = budget > 0
+        ? locale.formattedDataSize(qint64(budget) * 1024 * 1024) : tr("no limit");
+
+    infoLabel->setText(tr("Document: %0 blocks, %1\n"
+                          "Layout cache: %2 blocks, %3 (budget: %4)\n"
+                          "Layout hit rate: %5 (%6 hits, %7 misses)")
+                       .arg(locale.toString(current->blockCount()),
+                            locale.formattedDataSize(win->memoryUsage()),
+                            locale.toString(stats.blocks),
+                            locale.formattedDataSize(stats.bytes),
+                            limit, hitRate,
+                            locale.toString(stats.hits),
+                            locale.toString(stats.misses)));
+}
+
+AboutDialog::AboutDialog(QWidget *parent) : Dialog{parent} {
     setWindowTitle(tr("About") + " " + AppInfo::name());
     // Disable all background windows
     setModal(true);
@@ -1,14 +1,19 @@
 #pragma once
 
+#include "History.h"
+
 #include <QDialog>
 #include <QGridLayout>
 #include <QLineEdit>
 #include <QSpinBox>
+#include <QListWidget>
+#include <QPlainTextEdit>
 
 // Forward declarations
 class MainWindow;
 class Editor;
 class Highlighter;
+class QLabel;
 
 /**
  * @brief The base class for dialog boxes in the program.
@@ -25,12 +30,13 @@ public:
 protected:
     /**
      * @brief Initializes a new 'Dialog' instance.
-     * @param win The parent 'MainWindow' instance.
+     * @param parent The parent window, which is a 'MainWindow' instance
+     * for the dialogs that work on its editor.
      */
-    Dialog(MainWindow *win);
+    Dialog(QWidget *parent);
 
-    MainWindow *win;
-    Editor *editor;
+    MainWindow *win;    // The parent 'MainWindow' instance, or nullptr
+    Editor *editor;     // The editor of that window, or nullptr
 
     // Main layout of the dialog
     QGridLayout *mainLayout;
@@ -119,6 +125,81 @@ private:
     void go();
 };
 
+/**
+ * @brief Lists the saved versions of the current file,
+ * allowing the user to compare or restore them.
+ */
+class HistoryDialog : public Dialog {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Initializes a new 'HistoryDialog' instance.
+     * @param win The parent 'MainWindow' instance.
+     */
+    HistoryDialog(MainWindow *win);
+
+private:
+    // Display the saved versions
+    QListWidget *versionList;
+    // Display the differences to the editor content
+    QPlainTextEdit *diffView;
+    // Compare the selected version with the editor content
+    QPushButton *diffButton;
+    // Replace the editor content with the selected version
+    QPushButton *restoreButton;
+
+    QList<History::Version> versions;
+
+    /**
+     * @brief Reads the content of the selected version.
+     * @return The text of the selected version.
+     */
+    QString selectedText() const;
+
+    /**
+     * @brief Displays the differences between the selected version
+     * and the editor content.
+     */
+    void showDiff();
+
+    /**
+     * @brief Replaces the editor content with the selected version.
+     */
+    void restore();
+
+    /**
+     * @brief Compares two texts line by line.
+     * @param before The old text.
+     * @param after The new text.
+     * @return The changed lines, prefixed with '-' or '+'.
+     */
+    static QString diff(const QString &before, const QString &after);
+};
+
+/**
+ * @brief Displays how the current document uses memory,
+ * including the cache of block layouts.
+ */
+class DiagnosticsDialog : public Dialog {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Initializes a new 'DiagnosticsDialog' instance.
+     * @param win The parent 'MainWindow' instance.
+     */
+    DiagnosticsDialog(MainWindow *win);
+
+private:
+    QLabel *infoLabel;
+
+    /**
+     * @brief Updates the displayed statistics.
+     */
+    void updateInfo();
+};
+
 /**
  * @brief Displays program information.
  */
@@ -128,9 +209,9 @@ class AboutDialog : public Dialog {
 public:
     /**
      * @brief Initializes a new 'AboutDialog' instance.
-     * @param win The parent 'MainWindow' instance.
+     * @param parent The parent window.
      */
-    AboutDialog(MainWindow *win);
+    AboutDialog(QWidget *parent);
 
 private:
     QFrame *createInfoFrame();
@@ -3,10 +3,75 @@
 #include "StatusBar.h"
 #include "Attr.h"
 #include "AppInfo.h"
+#include "UndoStore.h"
+#include "FileUtil.h"
+#include "IpcUtil.h"
 
+#include <QDir>
+#include <QFileInfo>
+#include <QKeyEvent>
 #include <QMessageBox>
 #include <QPainter>
+#include <QFontInfo>
 #include <QMimeData>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include <algorithm>
+
+// Block format property of a display segment that continues the line
+// of the previous block
+static constexpr int CONTINUED = QTextFormat::UserProperty;
+// Document property that is set while any line is split into segments
+static constexpr char SEGMENTED[] = "segmented";
+// Character format property of the range that lets a block be shaped
+static constexpr int SHAPED = QTextFormat::UserProperty + 1;
+// Blocks of an edit checked for shaping right away; the blocks of larger
+// edits are checked when they are shown
+static constexpr int SHAPING_BLOCKS = 64;
+// Time that one slice of height estimates may take, in milliseconds
+static constexpr qint64 ESTIMATE_MSECS = 4;
+// Rough size of a block layout: shaped glyphs per character, plus the
+// layout objects themselves
+static constexpr qint64 LAYOUT_BYTES_PER_CHAR = 40;
+static constexpr qint64 LAYOUT_OVERHEAD = 512;
+
+/**
+ * @brief Checks whether a block continues the line of the previous block.
+ * @param block The block.
+ * @return true if the block is a display segment after the first;
+ * false otherwise.
+ */
+static bool isContinued(const QTextBlock &block) {
+    return block.isValid() && block.blockFormat().boolProperty(CONTINUED);
+}
+
+/**
+ * @brief Copies a range of a document with display segments joined
+ * into their lines.
+ * @param doc The document.
+ * @param start The start position of the range.
+ * @param end The end position of the range.
+ * @return The text in the range.
+ */
+static QString joinedText(const QTextDocument *doc, int start, int end) {
+    QString text;
+    for (QTextBlock block = doc->findBlock(start);
+         block.isValid() && block.position() <= end; block = block.next()) {
+        // Only the breaks between lines are kept
+        if (block.position() > start && !isContinued(block)) {
+            text += '\n';
+        }
+        const int from = qMax(start, block.position()) - block.position();
+        const int to = qMin(end, block.position() + block.length() - 1) - block.position();
+        text += QStringView{block.text()}.mid(from, to - from);
+    }
+
+    // Convert separators the same way as 'QTextDocument::toPlainText'
+    text.replace(QChar::LineSeparator, '\n');
+    text.replace(QChar::Nbsp, ' ');
+    return text;
+}
 
 Editor::Editor(MainWindow *win) : QPlainTextEdit{win}, win{win} {
     // Do not dim the selection background when the editor is out of focus
@@ -22,6 +87,16 @@ Editor::Editor(MainWindow *win) : QPlainTextEdit{win}, win{win} {
     connect(this, &Editor::blockCountChanged, this, &Editor::updateLineBarWidth);
     connect(this, &Editor::updateRequest, this, &Editor::updateLineBar);
 
+    // Estimate the heights of blocks off screen in idle slices,
+    // as only the blocks on screen are laid out
+    estimateTimer = new QTimer{this};
+    estimateTimer->setInterval(0);
+    estimateNext = 0;
+    connect(estimateTimer, &QTimer::timeout, this, &Editor::estimateSlice);
+
+    // Follow the segments of the document from its first edit
+    SegmentIndex::of(document());
+
     setWordWrap(Attr::get().wordWrap);
     setZoom(Attr::get().zoom);
 }
@@ -34,7 +109,7 @@ QTextCursor Editor::findPrev() {
     QTextCursor cursor{textCursor()};
     int start = cursor.position() - cursor.selectedText().size();
     auto flags = findFlags() | QTextDocument::FindBackward;
-    cursor = document()->find(Attr::get().findTarget, start, flags);
+    cursor = findTarget(start, flags);
 
     // Try to find the target from the current cursor position
     // If found, skip additional search
@@ -44,8 +119,8 @@ QTextCursor Editor::findPrev() {
     }
 
     // If not found, try again from the end of the document
-    start = toPlainText().size() - 1;
-    cursor = document()->find(Attr::get().findTarget, start, flags);
+    start = document()->characterCount() - 1;
+    cursor = findTarget(start, flags);
 
     if (!cursor.isNull()) {
         setTextCursor(cursor);
@@ -58,7 +133,7 @@ QTextCursor Editor::findNext() {
     QTextCursor cursor{textCursor()};
     int start = cursor.position();
     auto flags = findFlags();
-    cursor = document()->find(Attr::get().findTarget, start, flags);
+    cursor = findTarget(start, flags);
 
     // Try to find the target from the current cursor position
     // If found, skip additional search
@@ -69,7 +144,7 @@ QTextCursor Editor::findNext() {
 
     // If not found, try again from the beginning of the document
     start = 0;
-    cursor = document()->find(Attr::get().findTarget, start, flags);
+    cursor = findTarget(start, flags);
 
     if (!cursor.isNull()) {
         setTextCursor(cursor);
@@ -87,11 +162,8 @@ void Editor::replace() {
         return;
     }
 
-    int length = Attr::get().findTarget.length();
-    int start = cursor.position() - length;
-
-    cursor.setPosition(start);
-    cursor.setPosition(start + length, QTextCursor::KeepAnchor);
+    // A match across segments also spans the break between them
+    int start = cursor.selectionStart();
     cursor.insertText(Attr::get().replaceTarget);
     cursor.setPosition(start, QTextCursor::KeepAnchor);
     setTextCursor(cursor);
@@ -106,15 +178,31 @@ void Editor::replaceAll() {
         return;
     }
 
+    // Replace the matches of the file text from the last, so the positions
+    // of the others stay valid, rather than searching it again each time
+    if (hasSegments(document())) {
+        const auto index = SegmentIndex::of(document());
+        QList<QPair<int, int>> matches;
+        auto it = findPattern().globalMatch(fileText(document()));
+        while (it.hasNext()) {
+            const auto match = it.next();
+            matches.append({index->documentPosition(match.capturedStart(), false),
+                            index->documentPosition(match.capturedEnd(), true)});
+        }
+
+        cursor.beginEditBlock();
+        for (auto match = matches.crbegin(); match != matches.crend(); ++match) {
+            cursor.setPosition(match->first);
+            cursor.setPosition(match->second, QTextCursor::KeepAnchor);
+            cursor.insertText(Attr::get().replaceTarget);
+        }
+        cursor.endEditBlock();
+        return;
+    }
+
     // Ensure that every occurrence of the text snippet is replaced
     while (!cursor.isNull()) {
-        int length = Attr::get().findTarget.length();
-        int start = cursor.position() - length;
-
-        cursor.setPosition(start);
-        cursor.setPosition(start + length, QTextCursor::KeepAnchor);
         cursor.insertText(Attr::get().replaceTarget);
-
         cursor = findNext();
     }
 }
@@ -124,25 +212,39 @@ void Editor::showFindError() {
                           tr("'%0' not found!").arg(Attr::get().findTarget));
 }
 
-void Editor::goTo(int line) {
-    QTextCursor cursor{textCursor()};
-    cursor.movePosition(QTextCursor::Start);
-    cursor.movePosition(QTextCursor::Down, QTextCursor::MoveAnchor, line - 1);
-    cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, 0);
+void Editor::goTo(int line, int column) {
+    QTextBlock block{document()->findBlockByNumber(qBound(0, line - 1, blockCount() - 1))};
+    int offset = qMax(0, column - 1);
+
+    if (hasSegments(document())) {
+        // Only the blocks that start a line are counted
+        block = SegmentIndex::of(document())->lineBlock(line);
+        // Carry the column over into the following segments
+        while (offset > block.length() - 1 && isContinued(block.next())) {
+            offset -= block.length() - 1;
+            block = block.next();
+        }
+    }
+
+    QTextCursor cursor{block};
+    cursor.setPosition(block.position() + qBound(0, offset, block.length() - 1));
     setTextCursor(cursor);
+    centerCursor();
 }
 
 void Editor::lineBarPaintEvent(QPaintEvent *event) {
     QPainter painter{lineBar};
 
     QTextBlock block{firstVisibleBlock()};
-    int blockNumber = block.blockNumber();
+    // Segments of a long line share the number of that line
+    int lineNumber = hasSegments(document()) ? SegmentIndex::of(document())->lineOf(block)
+                                             : block.blockNumber() + 1;
     int top = blockBoundingGeometry(block).translated(contentOffset()).top();
     int bottom = top + blockBoundingRect(block).height();
 
     while (block.isValid() && top <= event->rect().bottom()) {
-        if (block.isVisible() && bottom >= event->rect().top()) {
-            const QString &number = QString::number(blockNumber + 1) + " ";
+        if (block.isVisible() && bottom >= event->rect().top() && !isContinued(block)) {
+            const QString &number = QString::number(lineNumber) + " ";
             painter.drawText(0, top, lineBar->width(), fontMetrics().height(),
                              Qt::AlignRight, number);
         }
@@ -150,12 +252,15 @@ void Editor::lineBarPaintEvent(QPaintEvent *event) {
         block = block.next();
         top = bottom;
         bottom = top + blockBoundingRect(block).height();
-        blockNumber++;
+        if (!isContinued(block)) {
+            lineNumber++;
+        }
     }
 }
 
 void Editor::setWordWrap(bool wrap) {
     setWordWrapMode(wrap ? QTextOption::WordWrap : QTextOption::NoWrap);
+    scheduleEstimate();
 }
 
 void Editor::setZoom(int zoom) {
@@ -171,11 +276,257 @@ void Editor::setZoom(int zoom) {
     lineBar->setFont(font);
 }
 
+void Editor::undo() {
+    // Nothing can be undone before the text is loaded
+    if (isReadOnly()) {
+        return;
+    }
+
+    // Bring back the history stored when the file was last closed,
+    // which is never stored for a document with display segments
+    if (!document()->isUndoAvailable() && !hasSegments(document())) {
+        // Silence every pane of the document, not only this one
+        const auto panes = win->findChildren<Editor *>();
+        for (auto pane : panes) {
+            pane->blockSignals(true);
+        }
+        const bool restored = UndoStore::restore(document(), win->getFilePath());
+        for (auto pane : panes) {
+            pane->blockSignals(false);
+        }
+        if (restored) {
+            emit undoAvailable(true);
+        }
+    }
+
+    QPlainTextEdit::undo();
+}
+
+QString Editor::plainText(const QTextDocument *doc, int start, int end) {
+    end = qMin(end, doc->characterCount() - 1);
+    if (end <= start) {
+        return "";
+    }
+
+    QTextCursor cursor{const_cast<QTextDocument *>(doc)};
+    cursor.setPosition(start);
+    cursor.setPosition(end, QTextCursor::KeepAnchor);
+
+    // Convert separators the same way as 'QTextDocument::toPlainText'
+    QString text{cursor.selectedText()};
+    text.replace(QChar::ParagraphSeparator, '\n');
+    text.replace(QChar::LineSeparator, '\n');
+    text.replace(QChar::Nbsp, ' ');
+    return text;
+}
+
+void Editor::setFileText(const QString &text) {
+    // Find where over-long lines are cut into segments
+    QList<int> cuts;
+    for (qsizetype start = 0; start <= text.size();) {
+        qsizetype end = text.indexOf('\n', start);
+        if (end < 0) {
+            end = text.size();
+        }
+        if (end - start > LONG_LINE) {
+            for (qsizetype pos = start + SEGMENT_LENGTH; pos < end; pos += SEGMENT_LENGTH) {
+                // Never cut a surrogate pair in half
+                if (text[pos - 1].isHighSurrogate()) {
+                    pos++;
+                }
+                if (pos < end) {
+                    cuts.append(static_cast<int>(pos));
+                }
+            }
+        }
+        start = end + 1;
+    }
+
+    document()->setProperty(SEGMENTED, !cuts.isEmpty());
+    if (cuts.isEmpty()) {
+        setPlainText(text);
+        scheduleEstimate();
+        return;
+    }
+
+    // Break the text at each cut, so every segment becomes a block
+    QString segmented;
+    segmented.reserve(text.size() + cuts.size());
+    qsizetype from = 0;
+    for (const int cut : std::as_const(cuts)) {
+        segmented += QStringView{text}.mid(from, cut - from);
+        segmented += '\n';
+        from = cut;
+    }
+    segmented += QStringView{text}.mid(from);
+    setPlainText(segmented);
+
+    // Mark the blocks after the cuts, which is not an edit to be undone
+    QTextBlockFormat format;
+    format.setProperty(CONTINUED, true);
+    document()->setUndoRedoEnabled(false);
+    QTextCursor cursor{document()};
+    cursor.beginEditBlock();
+    for (qsizetype i = 0; i < cuts.size(); i++) {
+        cursor.setPosition(cuts[i] + static_cast<int>(i) + 1);
+        cursor.mergeBlockFormat(format);
+    }
+    cursor.endEditBlock();
+    document()->setUndoRedoEnabled(true);
+    scheduleEstimate();
+}
+
+bool Editor::hasSegments(const QTextDocument *doc) {
+    return doc->property(SEGMENTED).toBool();
+}
+
+QString Editor::fileText(const QTextDocument *doc) {
+    if (!hasSegments(doc)) {
+        return doc->toPlainText();
+    }
+    return joinedText(doc, 0, doc->characterCount() - 1);
+}
+
+QString Editor::fileText(const QTextDocument *doc, int start, int end) {
+    if (!hasSegments(doc)) {
+        return plainText(doc, start, end);
+    }
+    return joinedText(doc, start, qMin(end, doc->characterCount() - 1));
+}
+
+void Editor::cursorPos(int &line, int &column) const {
+    const QTextCursor &cursor = textCursor();
+    line = cursor.blockNumber() + 1;
+    column = cursor.positionInBlock() + 1;
+    if (!hasSegments(document())) {
+        return;
+    }
+
+    // The segments before the cursor are part of its line, less the
+    // break that ends each of them
+    const auto index = SegmentIndex::of(document());
+    line = index->lineOf(cursor.block());
+    const QTextBlock &start = index->lineBlock(line);
+    column = cursor.position() - start.position() -
+             (cursor.blockNumber() - start.blockNumber()) + 1;
+}
+
+int Editor::lineCount() const {
+    if (!hasSegments(document())) {
+        return blockCount();
+    }
+    return SegmentIndex::of(document())->lineCount();
+}
+
+Editor::LayoutStats Editor::layoutStats() const {
+    return LayoutCache::of(document())->stats();
+}
+
+void Editor::trimLayouts() {
+    LayoutCache::of(document())->trim();
+}
+
+void Editor::paintEvent(QPaintEvent *event) {
+    noteLayouts();
+    QPlainTextEdit::paintEvent(event);
+    trimLayouts();
+}
+
+void Editor::noteLayouts() {
+    // Follow the edits of the document being painted, which is replaced
+    // when the editor becomes a split pane
+    if (layoutDoc != document()) {
+        if (layoutDoc) {
+            disconnect(layoutDoc, &QTextDocument::contentsChange, this, &Editor::updateShaping);
+            LayoutCache::of(layoutDoc)->removePane(this);
+        }
+        layoutDoc = document();
+        connect(layoutDoc, &QTextDocument::contentsChange, this, &Editor::updateShaping);
+    }
+
+    const auto cache = LayoutCache::of(layoutDoc);
+    const quint64 previous = cache->startPaint();
+    const QPointF offset{contentOffset()};
+    const int bottom = viewport()->height();
+
+    QTextBlock block{firstVisibleBlock()};
+    const int firstShown = block.blockNumber();
+    int lastShown = firstShown - 1;
+    for (int number = firstShown; block.isValid(); block = block.next(), number++) {
+        if (!block.isVisible()) {
+            continue;
+        }
+
+        // Check the cache before the geometry lays the block out
+        const bool laidOut = block.layout()->lineCount() > 0;
+        if (!laidOut) {
+            applyShaping(block);
+        }
+        if (blockBoundingGeometry(block).translated(offset).top() > bottom) {
+            break;
+        }
+        lastShown = number;
+        cache->note(block, laidOut, previous);
+    }
+    cache->setShown(this, firstShown, lastShown);
+}
+
 void Editor::resizeEvent(QResizeEvent *event) {
     QPlainTextEdit::resizeEvent(event);
 
     const QRect &rect{contentsRect()};
     lineBar->setGeometry(rect.left(), rect.top(), lineBarWidth(), rect.height());
+
+    // Wrapped blocks take a different number of lines in another width
+    if (event->size().width() != event->oldSize().width()) {
+        scheduleEstimate();
+    }
+}
+
+void Editor::keyPressEvent(QKeyEvent *event) {
+    // Route the shortcut through 'undo', which may restore the history
+    if (event->matches(QKeySequence::Undo)) {
+        undo();
+        event->accept();
+        return;
+    }
+
+    if (hasSegments(document()) && !isReadOnly()) {
+        QTextCursor cursor{textCursor()};
+
+        // A line break typed inside a segment starts a real line
+        if (event->matches(QKeySequence::InsertParagraphSeparator)) {
+            QTextBlockFormat format{cursor.blockFormat()};
+            format.clearProperty(CONTINUED);
+            cursor.insertBlock(format);
+            setTextCursor(cursor);
+            ensureCursorVisible();
+            event->accept();
+            return;
+        }
+
+        // Deleting at a segment boundary removes the character beyond it,
+        // rather than joining the segments
+        const bool plain = event->modifiers() == Qt::NoModifier && !cursor.hasSelection();
+        if (plain && event->key() == Qt::Key_Backspace &&
+            cursor.atBlockStart() && isContinued(cursor.block())) {
+            cursor.movePosition(QTextCursor::PreviousCharacter);
+            cursor.deletePreviousChar();
+            setTextCursor(cursor);
+            event->accept();
+            return;
+        }
+        if (plain && event->key() == Qt::Key_Delete &&
+            cursor.atBlockEnd() && isContinued(cursor.block().next())) {
+            cursor.movePosition(QTextCursor::NextCharacter);
+            cursor.deleteChar();
+            setTextCursor(cursor);
+            event->accept();
+            return;
+        }
+    }
+
+    QPlainTextEdit::keyPressEvent(event);
 }
 
 void Editor::dragEnterEvent(QDragEnterEvent *event) {
@@ -193,10 +544,72 @@ void Editor::dropEvent(QDropEvent *event) {
         return;
     }
 
+    // Limits on what a single drop may open
+    int maxCount = 200;
+    qint64 maxSize = 256 * 1024 * 1024;
+    bool truncated = false;
+
+    // Expand dropped directories into the files they contain
+    QList<FileTarget> targets;
     const auto urls = mimeData->urls();
     for (const auto &url : urls) {
-        MainWindow::open(url.toLocalFile());
+        const QString &path = url.toLocalFile();
+        if (!QFileInfo{path}.isDir()) {
+            targets.append({path});
+            continue;
+        }
+        const QStringList &files = FileUtil::listFiles(path, maxCount, maxSize, truncated);
+        for (const auto &file : files) {
+            targets.append({file});
+        }
+    }
+
+    // Open all windows at once, then load their files in the background
+    MainWindow::openAll(targets, QDir::currentPath());
+
+    if (truncated) {
+        QMessageBox::warning(win, AppInfo::name(),
+                             tr("Some files in the dropped folders were not opened, "
+                                "because there are too many or they are too large."));
+    }
+}
+
+QMimeData *Editor::createMimeDataFromSelection() const {
+    if (!hasSegments(document())) {
+        return QPlainTextEdit::createMimeDataFromSelection();
     }
+
+    const QTextCursor &cursor = textCursor();
+    auto data = new QMimeData;
+    data->setText(joinedText(document(), cursor.selectionStart(), cursor.selectionEnd()));
+    return data;
+}
+
+void Editor::insertFromMimeData(const QMimeData *source) {
+    if (!hasSegments(document()) || !source->hasText()) {
+        QPlainTextEdit::insertFromMimeData(source);
+        return;
+    }
+
+    // Pasted line breaks start real lines, even inside a segment
+    QString text{source->text()};
+    text.replace("\r\n", "\n");
+    text.replace('\r', '\n');
+    const QStringList &lines = text.split('\n');
+
+    QTextCursor cursor{textCursor()};
+    QTextBlockFormat format{cursor.blockFormat()};
+    format.clearProperty(CONTINUED);
+    cursor.beginEditBlock();
+    for (qsizetype i = 0; i < lines.size(); i++) {
+        if (i > 0) {
+            cursor.insertBlock(format);
+        }
+        cursor.insertText(lines[i]);
+    }
+    cursor.endEditBlock();
+    setTextCursor(cursor);
+    ensureCursorVisible();
 }
 
 QTextDocument::FindFlags Editor::findFlags() {
@@ -210,6 +623,43 @@ QTextDocument::FindFlags Editor::findFlags() {
     return flags;
 }
 
+QTextCursor Editor::findTarget(int from, QTextDocument::FindFlags flags) {
+    if (!hasSegments(document())) {
+        return document()->find(Attr::get().findTarget, from, flags);
+    }
+
+    // 'QTextDocument::find' only matches within a block, so search the
+    // text with the segments joined back into their lines
+    const auto index = SegmentIndex::of(document());
+    const QString &text = fileText(document());
+    const int start = index->filePosition(from);
+    QRegularExpressionMatch match;
+    const qsizetype found = (flags & QTextDocument::FindBackward)
+        ? (start > 0 ? text.lastIndexOf(findPattern(), start - 1, &match) : -1)
+        : text.indexOf(findPattern(), start, &match);
+    if (found < 0) {
+        return {};
+    }
+
+    QTextCursor cursor{document()};
+    cursor.setPosition(index->documentPosition(match.capturedStart(), false));
+    cursor.setPosition(index->documentPosition(match.capturedEnd(), true),
+                       QTextCursor::KeepAnchor);
+    return cursor;
+}
+
+QRegularExpression Editor::findPattern() {
+    QString pattern = QRegularExpression::escape(Attr::get().findTarget);
+    if (Attr::get().matchWholeWord) {
+        pattern = "\\b" + pattern + "\\b";
+    }
+    QRegularExpression ex{pattern};
+    if (!Attr::get().matchCase) {
+        ex.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+    }
+    return ex;
+}
+
 int Editor::lineBarWidth() {
     // Hide the line bar by setting its width to 0
     if (!Attr::get().showLine) {
@@ -238,8 +688,335 @@ void Editor::updateLineBar(const QRect &rect, int dy) {
 }
 
 void Editor::setFont(const QFont &font) {
-    QPlainTextEdit::setFont(font);
+    // Monospace glyphs are placed from their advances alone, which skips
+    // shaping; Qt still shapes the scripts that require it
+    QFont editorFont{font};
+    if (QFontInfo{font}.fixedPitch()) {
+        editorFont.setStyleStrategy(
+            QFont::StyleStrategy(font.styleStrategy() | QFont::PreferNoShaping));
+    }
+    QPlainTextEdit::setFont(editorFont);
     lineBar->setFont(font);
+    scheduleEstimate();
+}
+
+bool Editor::needsShaping(QStringView text) {
+    return std::any_of(text.begin(), text.end(), [] (QChar c) {
+        return c.unicode() >= 0x0300 &&
+               (c.isMark() || c.isSurrogate() || c.unicode() == 0x200D);
+    });
+}
+
+QTextCharFormat Editor::shapingFormat() const {
+    QTextCharFormat format;
+    format.setFontStyleStrategy(
+        QFont::StyleStrategy(font().styleStrategy() & ~QFont::PreferNoShaping));
+    format.setProperty(SHAPED, true);
+    return format;
+}
+
+void Editor::updateShaping(int pos, int, int added) {
+    QTextBlock block{layoutDoc->findBlock(pos)};
+    for (int count = 0; block.isValid() && block.position() <= pos + added &&
+                        count < SHAPING_BLOCKS; block = block.next(), count++) {
+        applyShaping(block);
+    }
+}
+
+void Editor::applyShaping(const QTextBlock &block) {
+    // The highlighter lets the blocks it formats be shaped itself
+    QTextLayout *layout = block.layout();
+    const auto &formats = layout->formats();
+    const bool shaped = formats.size() == 1 && formats[0].format.hasProperty(SHAPED);
+    if (!formats.isEmpty() && !shaped) {
+        return;
+    }
+
+    // Cover the whole block, which may have grown since it was shaped
+    const bool needed = needsShaping(block.text());
+    if (needed == shaped && (!needed || formats[0].length == block.length())) {
+        return;
+    }
+    QList<QTextLayout::FormatRange> ranges;
+    if (needed) {
+        ranges.append({0, block.length(), shapingFormat()});
+    }
+    layout->setFormats(ranges);
+    block.document()->markContentsDirty(block.position(), block.length());
+}
+
+void Editor::scheduleEstimate() {
+    // The change cleared every layout, so the cache is empty again
+    LayoutCache::of(document())->clear();
+
+    estimateNext = 0;
+    estimateTimer->start();
+}
+
+void Editor::estimateSlice() {
+    // Without word wrap, every block takes one line, as already assumed
+    if (wordWrapMode() == QTextOption::NoWrap) {
+        estimateTimer->stop();
+        return;
+    }
+
+    const qreal width = viewport()->width() - 2 * document()->documentMargin();
+    const int charsPerLine = qMax(1, static_cast<int>(width / qMax(1, fontMetrics().averageCharWidth())));
+
+    QElapsedTimer clock;
+    clock.start();
+    bool changed = false;
+    QTextBlock block{document()->findBlockByNumber(estimateNext)};
+    for (; block.isValid(); block = block.next(), estimateNext++) {
+        // Check the time only once in a while, as each block is cheap
+        if ((estimateNext & 0xFF) == 0 && clock.hasExpired(ESTIMATE_MSECS)) {
+            break;
+        }
+
+        // Blocks laid out for any pane or the cursor already have their
+        // exact heights
+        if (!block.isVisible() || block.layout()->lineCount() > 0) {
+            continue;
+        }
+
+        // Guess the number of wrapped lines from the length of the block
+        const int lines = qMax(1, (block.length() - 1 + charsPerLine - 1) / charsPerLine);
+        if (block.lineCount() != lines) {
+            block.setLineCount(lines);
+            changed = true;
+        }
+    }
+
+    // Let the scroll bar follow the new heights, keeping the top block in place
+    if (changed) {
+        auto layout = document()->documentLayout();
+        emit layout->documentSizeChanged(layout->documentSize());
+    }
+    if (!block.isValid()) {
+        estimateTimer->stop();
+    }
+}
+
+SegmentIndex::SegmentIndex(QTextDocument *doc)
+    : QObject{doc}, doc{doc}, blocks{0}, lastRemoved{0} {
+    connect(doc, &QTextDocument::contentsChange, this, &SegmentIndex::update);
+    update(0, 0, doc->characterCount());
+}
+
+SegmentIndex *SegmentIndex::of(const QTextDocument *doc) {
+    if (auto index = doc->findChild<SegmentIndex *>(Qt::FindDirectChildrenOnly)) {
+        return index;
+    }
+    return new SegmentIndex{const_cast<QTextDocument *>(doc)};
+}
+
+int SegmentIndex::lineOf(const QTextBlock &block) const {
+    const int number = block.blockNumber();
+    const auto after = std::upper_bound(continued.cbegin(), continued.cend(), number);
+    return number + 1 - static_cast<int>(after - continued.cbegin());
+}
+
+int SegmentIndex::lineCount() const {
+    return doc->blockCount() - static_cast<int>(continued.size());
+}
+
+QTextBlock SegmentIndex::lineBlock(int line) const {
+    // Skip one more block for each segment up to the line
+    int number = qMax(0, line - 1);
+    for (const int segment : continued) {
+        if (segment > number) {
+            break;
+        }
+        number++;
+    }
+    return doc->findBlockByNumber(qMin(number, doc->blockCount() - 1));
+}
+
+int SegmentIndex::filePosition(int pos) const {
+    // Each segment up to the position follows one break that is not in the file
+    const int number = doc->findBlock(pos).blockNumber();
+    const auto after = std::upper_bound(continued.cbegin(), continued.cend(), number);
+    return pos - static_cast<int>(after - continued.cbegin());
+}
+
+int SegmentIndex::documentPosition(int filePos, bool end) const {
+    // Count the segments that start before the position in the file,
+    // where the i-th segment starts at its block position less i + 1
+    qsizetype low = 0;
+    qsizetype high = continued.size();
+    while (low < high) {
+        const qsizetype mid = (low + high) / 2;
+        const int start = doc->findBlockByNumber(continued[mid]).position() -
+                          static_cast<int>(mid) - 1;
+        if (end ? start < filePos : start <= filePos) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return filePos + static_cast<int>(low);
+}
+
+int SegmentIndex::removedBreaks() const {
+    return lastRemoved;
+}
+
+void SegmentIndex::update(int pos, int, int added) {
+    const int count = doc->blockCount();
+    const int shift = count - blocks;
+    blocks = count;
+
+    // Documents without segments are never scanned
+    lastRemoved = 0;
+    if (!Editor::hasSegments(doc)) {
+        continued.clear();
+        return;
+    }
+
+    // The blocks touched by the change, which were fewer or more before it
+    const QTextBlock first{doc->findBlock(pos)};
+    const int firstNumber = qMax(0, first.blockNumber());
+    const int lastNumber = doc->findBlock(qMin(pos + added, doc->characterCount() - 1)).blockNumber();
+
+    QList<int> scanned;
+    int number = firstNumber;
+    for (QTextBlock block = first; block.isValid() && number <= lastNumber; block = block.next()) {
+        if (isContinued(block)) {
+            scanned.append(number);
+        }
+        number++;
+    }
+
+    // Replace the touched blocks, and shift the numbers of those after them
+    const auto from = std::lower_bound(continued.begin(), continued.end(), firstNumber);
+    const auto to = std::upper_bound(from, continued.end(), lastNumber - shift);
+    // The segments after the first touched block lost the break before them
+    lastRemoved = static_cast<int>(to - std::upper_bound(from, to, firstNumber));
+    for (auto it = to; it != continued.end(); ++it) {
+        *it += shift;
+    }
+    const qsizetype at = from - continued.begin();
+    continued.remove(at, to - from);
+    for (qsizetype i = 0; i < scanned.size(); i++) {
+        continued.insert(at + i, scanned[i]);
+    }
+}
+
+LayoutCache::LayoutCache(QTextDocument *doc)
+    : QObject{doc}, doc{doc}, paintTick{0}, bytes{0}, hits{0}, misses{0},
+      blocks{doc->blockCount()} {
+    connect(doc, &QTextDocument::contentsChange, this, &LayoutCache::shift);
+}
+
+LayoutCache *LayoutCache::of(const QTextDocument *doc) {
+    if (auto cache = doc->findChild<LayoutCache *>(Qt::FindDirectChildrenOnly)) {
+        return cache;
+    }
+    return new LayoutCache{const_cast<QTextDocument *>(doc)};
+}
+
+quint64 LayoutCache::startPaint() {
+    return paintTick++;
+}
+
+void LayoutCache::note(const QTextBlock &block, bool laidOut, quint64 previous) {
+    auto it = layouts.find(block.blockNumber());
+    const bool isNew = it == layouts.end();
+    if (isNew) {
+        it = layouts.insert(block.blockNumber(), {paintTick, 0});
+    }
+
+    // Only count blocks that have just come into view in some pane
+    if (isNew || it->tick < previous) {
+        laidOut ? hits++ : misses++;
+    }
+    const qint64 size = block.length() * LAYOUT_BYTES_PER_CHAR + LAYOUT_OVERHEAD;
+    bytes += size - it->bytes;
+    it->bytes = size;
+    it->tick = paintTick;
+}
+
+void LayoutCache::setShown(const Editor *pane, int first, int last) {
+    // Forget the pane once it is gone
+    if (!shown.contains(pane)) {
+        connect(pane, &QObject::destroyed, this, &LayoutCache::removePane);
+    }
+    shown.insert(pane, {first, last});
+}
+
+void LayoutCache::removePane(const QObject *pane) {
+    if (shown.remove(pane)) {
+        disconnect(pane, &QObject::destroyed, this, &LayoutCache::removePane);
+    }
+}
+
+void LayoutCache::trim() {
+    const qint64 budget = qint64(Attr::get().layoutBudget) * 1024 * 1024;
+    if (budget <= 0 || bytes <= budget) {
+        return;
+    }
+
+    // Order the blocks off screen in every pane from the least recently shown
+    QList<QPair<quint64, int>> order;
+    order.reserve(layouts.size());
+    for (auto it = layouts.cbegin(); it != layouts.cend(); ++it) {
+        const bool onScreen = std::any_of(shown.cbegin(), shown.cend(),
+                                          [number = it.key()] (const QPair<int, int> &range) {
+            return number >= range.first && number <= range.second;
+        });
+        if (!onScreen) {
+            order.append({it->tick, it.key()});
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    // Release down to three quarters of the budget, so that scrolling
+    // does not release layouts on every paint
+    for (const auto &[tick, number] : std::as_const(order)) {
+        if (bytes <= budget * 3 / 4) {
+            break;
+        }
+        QTextBlock block{doc->findBlockByNumber(number)};
+        if (block.isValid()) {
+            block.clearLayout();
+        }
+        bytes -= layouts.take(number).bytes;
+    }
+}
+
+void LayoutCache::clear() {
+    layouts.clear();
+    bytes = 0;
+}
+
+Editor::LayoutStats LayoutCache::stats() const {
+    return {static_cast<int>(layouts.size()), bytes, hits, misses};
+}
+
+void LayoutCache::shift(int pos, int, int added) {
+    const int count = doc->blockCount();
+    const int shift = count - blocks;
+    blocks = count;
+    if (shift == 0 || layouts.isEmpty()) {
+        return;
+    }
+
+    // Blocks before the change keep their numbers, and blocks after it move
+    // by the lines added or removed; the blocks in between were replaced
+    const int first = doc->findBlock(pos).blockNumber();
+    const int last = doc->findBlock(qMin(pos + added, doc->characterCount() - 1)).blockNumber();
+    QHash<int, CachedLayout> shifted;
+    shifted.reserve(layouts.size());
+    for (auto it = layouts.cbegin(); it != layouts.cend(); ++it) {
+        if (it.key() <= first) {
+            shifted.insert(it.key(), *it);
+        } else if (it.key() > last - shift) {
+            shifted.insert(it.key() + shift, *it);
+        } else {
+            bytes -= it->bytes;
+        }
+    }
+    layouts.swap(shifted);
 }
 
 Highlighter::Highlighter(Editor *editor)
@@ -266,12 +1043,20 @@ void Highlighter::updateTarget() {
 }
 
 void Highlighter::highlightBlock(const QString &text) {
+    // The formats replace those of the editor, so keep the block shaped
+    QTextCharFormat matchFormat{format};
+    if (Editor::needsShaping(text)) {
+        const QTextCharFormat &shaping = editor->shapingFormat();
+        setFormat(0, text.size(), shaping);
+        matchFormat.merge(shaping);
+    }
+
     auto matches = ex.globalMatch(text);
     int size = Attr::get().findTarget.size();
 
     while (matches.hasNext()) {
         auto match = matches.next();
-        setFormat(match.capturedStart(), size, format);
+        setFormat(match.capturedStart(), size, matchFormat);
     }
 }
 
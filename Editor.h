@@ -1,12 +1,17 @@
 #pragma once
 
 #include <QPlainTextEdit>
+#include <QHash>
+#include <QPointer>
 #include <QSyntaxHighlighter>
 #include <QRegularExpression>
 
 // Forward declarations
 class MainWindow;
 class LineBar;
+class QTimer;
+class SegmentIndex;
+class LayoutCache;
 
 /**
  * @brief Interface for text editing.
@@ -15,6 +20,11 @@ class Editor : public QPlainTextEdit {
     Q_OBJECT
 
 public:
+    /// Length from which a line is split into display segments.
+    static constexpr int LONG_LINE = 10000;
+    /// Number of characters in each display segment of a long line.
+    static constexpr int SEGMENT_LENGTH = 1000;
+
     /**
      * @brief Initializes a new 'Editor' instance.
      * @param win The parent 'MainWindow' instance.
@@ -61,10 +71,12 @@ public:
 
     /**
      * @brief Moves the text cursor to a specific line in the editor.
-     * @note This method will only work if word wrap is disabled.
-     * @param line The line to go to.
+     * @note The line is looked up directly, without moving through the
+     * lines before it.
+     * @param line The line to go to, starting from 1.
+     * @param column The column to go to, starting from 1.
      */
-    void goTo(int line);
+    void goTo(int line, int column = 1);
 
     /**
      * @brief Updates the width of the line bar.
@@ -91,12 +103,128 @@ public:
 
     /**
      * @brief Sets the font of the text editor and the line numbers.
+     * @note In a monospace font, text is not shaped, so its glyphs are
+     * placed from their advances and never form ligatures. Blocks that
+     * 'needsShaping' are still shaped.
      * @param font The font of the text editor and the line numbers.
      */
     void setFont(const QFont &font);
 
+    /**
+     * @brief Checks whether text must be shaped, even in a monospace font.
+     * @note Scripts that require shaping, such as Arabic, are always shaped.
+     * @param text The text.
+     * @return true if the text has combining marks, joiners or characters
+     * outside the Basic Multilingual Plane; false otherwise.
+     */
+    static bool needsShaping(QStringView text);
+
+    /**
+     * @brief Provides the format that lets a block be shaped.
+     * @return The format, which keeps the rest of the editor font.
+     */
+    QTextCharFormat shapingFormat() const;
+
+    /**
+     * @brief Undoes the last edit.
+     * @note If the document has no undo history yet, the history stored
+     * when the file was last closed is restored first.
+     */
+    void undo();
+
+    /**
+     * @brief Copies a range of a document as plain text.
+     * @note Separators are converted the same way as 'toPlainText'.
+     * @param doc The document.
+     * @param start The start position of the range.
+     * @param end The end position of the range.
+     * @return The text in the range.
+     */
+    static QString plainText(const QTextDocument *doc, int start, int end);
+
+    /**
+     * @brief Replaces the text with the content of a file.
+     * @note Lines longer than 'LONG_LINE' are split into blocks of
+     * 'SEGMENT_LENGTH' characters, so that only the segments on screen
+     * are laid out instead of the whole line.
+     * @param text The file content.
+     */
+    void setFileText(const QString &text);
+
+    /**
+     * @brief Checks whether a document has lines split into display segments.
+     * @param doc The document.
+     * @return true if any line is split; false otherwise.
+     */
+    static bool hasSegments(const QTextDocument *doc);
+
+    /**
+     * @brief Copies the text of a document as it is saved to the file,
+     * with display segments joined back into their lines.
+     * @param doc The document.
+     * @return The text of the document.
+     */
+    static QString fileText(const QTextDocument *doc);
+
+    /**
+     * @brief Copies a range of a document as it is saved to the file.
+     * @param doc The document.
+     * @param start The start position of the range.
+     * @param end The end position of the range.
+     * @return The text in the range.
+     */
+    static QString fileText(const QTextDocument *doc, int start, int end);
+
+    /**
+     * @brief Provides the position of the text cursor in the file,
+     * counting display segments as part of their lines.
+     * @param line Receives the line, starting from 1.
+     * @param column Receives the column, starting from 1.
+     */
+    void cursorPos(int &line, int &column) const;
+
+    /**
+     * @brief Provides the number of lines in the file.
+     * @return The number of lines, not counting display segments.
+     */
+    int lineCount() const;
+
+    /**
+     * @brief Describes the block layouts cached by the editor.
+     */
+    struct LayoutStats {
+        /// Number of cached block layouts.
+        int blocks;
+        /// Estimated size of the cached layouts in bytes.
+        qint64 bytes;
+        /// Blocks shown again whose layout was still cached.
+        quint64 hits;
+        /// Blocks shown that had to be laid out.
+        quint64 misses;
+    };
+
+    /**
+     * @brief Provides statistics of the cached block layouts.
+     * @return The statistics.
+     */
+    LayoutStats layoutStats() const;
+
+    /**
+     * @brief Releases the layouts of the blocks shown least recently,
+     * until the cache of the document fits in the budget.
+     * @note Blocks on screen in any pane keep their layouts, and released
+     * layouts are recreated when their blocks are shown again.
+     */
+    void trimLayouts();
+
 protected:
+    void paintEvent(QPaintEvent *event) override;
     void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+
+    // Keep display segments out of copied and pasted text
+    QMimeData *createMimeDataFromSelection() const override;
+    void insertFromMimeData(const QMimeData *source) override;
 
     // Enable drag & drop of files
     void dragEnterEvent(QDragEnterEvent *event) override;
@@ -106,12 +234,62 @@ private:
     MainWindow *win;
     LineBar *lineBar;
 
+    QTimer *estimateTimer;              // Runs the height estimates when idle
+    int estimateNext;                   // The next block to estimate
+
+    QPointer<QTextDocument> layoutDoc;  // The document last painted
+
+    /**
+     * @brief Records the blocks about to be painted in the layout cache.
+     */
+    void noteLayouts();
+
+    /**
+     * @brief Lets the edited blocks be shaped if they need it,
+     * as reported by 'contentsChange'.
+     */
+    void updateShaping(int pos, int removed, int added);
+
+    /**
+     * @brief Lets a block be shaped if it needs it, before it is laid out.
+     * @param block The block.
+     */
+    void applyShaping(const QTextBlock &block);
+
+    /**
+     * @brief Starts estimating the heights of the blocks again,
+     * after a change that cleared their layouts.
+     */
+    void scheduleEstimate();
+
+    /**
+     * @brief Estimates the heights of the next blocks from their lengths,
+     * for as long as one idle slice allows.
+     */
+    void estimateSlice();
+
     /**
      * @brief Configures the search flags based on the preferences.
      * @return The configured search flags.
      */
     QTextDocument::FindFlags findFlags();
 
+    /**
+     * @brief Finds the target text from a position.
+     * @note In a document with display segments, the file text is searched,
+     * so that matches across the cut between two segments are found.
+     * @param from The position to search from.
+     * @param flags The search flags.
+     * @return The selected match, or a null cursor if not found.
+     */
+    QTextCursor findTarget(int from, QTextDocument::FindFlags flags);
+
+    /**
+     * @brief Builds the expression that matches the target text.
+     * @return The expression.
+     */
+    QRegularExpression findPattern();
+
     /**
      * @brief Calculates the width of the line bar.
      * @return The width of the line bar.
@@ -126,6 +304,187 @@ private:
     void updateLineBar(const QRect &rect, int dy);
 };
 
+/**
+ * @brief Keeps track of the display segments of a document, so that
+ * line numbers are found without walking through the blocks.
+ * @note The index lives with the document and is shared by every pane.
+ * Only the blocks touched by an edit are checked again.
+ */
+class SegmentIndex : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Provides the index of a document, creating it on first use.
+     * @param doc The document.
+     * @return The index.
+     */
+    static SegmentIndex *of(const QTextDocument *doc);
+
+    /**
+     * @brief Provides the line of a block, not counting display segments.
+     * @param block The block.
+     * @return The line, starting from 1.
+     */
+    int lineOf(const QTextBlock &block) const;
+
+    /**
+     * @brief Provides the number of lines, not counting display segments.
+     * @return The number of lines.
+     */
+    int lineCount() const;
+
+    /**
+     * @brief Finds the block that starts a line.
+     * @param line The line, starting from 1.
+     * @return The first block of the line.
+     */
+    QTextBlock lineBlock(int line) const;
+
+    /**
+     * @brief Converts a position in the document to a position in the file.
+     * @param pos The position in the document.
+     * @return The position in the file text.
+     */
+    int filePosition(int pos) const;
+
+    /**
+     * @brief Converts a position in the file to a position in the document.
+     * @param filePos The position in the file text.
+     * @param end Whether the position ends a range, which keeps it before
+     * the break of a segment rather than after it.
+     * @return The position in the document.
+     */
+    int documentPosition(int filePos, bool end) const;
+
+    /**
+     * @brief Provides the number of breaks between segments that the last
+     * change of the document removed.
+     * @return The number of breaks.
+     */
+    int removedBreaks() const;
+
+private:
+    QTextDocument *doc;
+    QList<int> continued;   // Numbers of the blocks that continue a line, in order
+    int blocks;             // Number of blocks when the index was last updated
+    int lastRemoved;        // Breaks between segments removed by the last change
+
+    /**
+     * @brief Initializes a new 'SegmentIndex' instance.
+     * @param doc The document, which becomes the parent.
+     */
+    SegmentIndex(QTextDocument *doc);
+
+    /**
+     * @brief Checks the blocks touched by a change of the document again,
+     * and shifts the blocks after them.
+     * @param pos The position of the change.
+     * @param removed The number of removed characters.
+     * @param added The number of added characters.
+     */
+    void update(int pos, int removed, int added);
+};
+
+/**
+ * @brief Keeps track of the block layouts of a document, so that the
+ * layouts shown least recently are released first.
+ * @note The layouts belong to the document, so the cache lives with it
+ * and is shared by every pane, each of which reports the blocks it shows.
+ */
+class LayoutCache : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Provides the cache of a document, creating it on first use.
+     * @param doc The document.
+     * @return The cache.
+     */
+    static LayoutCache *of(const QTextDocument *doc);
+
+    /**
+     * @brief Starts recording the blocks of a paint.
+     * @return The paint before this one.
+     */
+    quint64 startPaint();
+
+    /**
+     * @brief Records a block about to be painted.
+     * @param block The block.
+     * @param laidOut Whether the block was laid out before the paint.
+     * @param previous The paint before this one.
+     */
+    void note(const QTextBlock &block, bool laidOut, quint64 previous);
+
+    /**
+     * @brief Records the blocks on screen in a pane, which keep their layouts.
+     * @param pane The pane.
+     * @param first The first block on screen.
+     * @param last The last block on screen.
+     */
+    void setShown(const Editor *pane, int first, int last);
+
+    /**
+     * @brief Forgets the blocks shown by a pane, once it shows another
+     * document or is deleted.
+     * @param pane The pane.
+     */
+    void removePane(const QObject *pane);
+
+    /**
+     * @brief Releases the layouts of the blocks shown least recently,
+     * until the cache fits in the budget.
+     */
+    void trim();
+
+    /**
+     * @brief Forgets every cached layout, after a change cleared them.
+     */
+    void clear();
+
+    /**
+     * @brief Provides statistics of the cached layouts.
+     * @return The statistics.
+     */
+    Editor::LayoutStats stats() const;
+
+private:
+    /**
+     * @brief A block whose layout is cached.
+     */
+    struct CachedLayout {
+        quint64 tick;   // The paint that last showed the block
+        qint64 bytes;   // Estimated size of the layout
+    };
+
+    QTextDocument *doc;
+    // Cached layouts by block number, in the order they were shown
+    QHash<int, CachedLayout> layouts;
+    // The first and last blocks on screen in each pane
+    QHash<const QObject *, QPair<int, int>> shown;
+    quint64 paintTick;
+    qint64 bytes;
+    quint64 hits;
+    quint64 misses;
+    int blocks;         // Number of blocks after the last change
+
+    /**
+     * @brief Initializes a new 'LayoutCache' instance.
+     * @param doc The document, which becomes the parent.
+     */
+    LayoutCache(QTextDocument *doc);
+
+    /**
+     * @brief Moves the cached layouts along with their blocks after lines
+     * are added or removed.
+     * @param pos The position of the change.
+     * @param removed The number of removed characters.
+     * @param added The number of added characters.
+     */
+    void shift(int pos, int removed, int added);
+};
+
 /**
  * @brief Highlights a text snippet inside the editor in yellow.
  */
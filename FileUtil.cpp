@@ -1,6 +1,32 @@
 #include "FileUtil.h"
 
+#include <QDir>
+#include <QDirIterator>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+
+#ifdef Q_OS_WINDOWS
+#include <fcntl.h>
+#include <io.h>
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+// Number of trailing bytes hashed by 'FileUtil::stamp'
+static constexpr qint64 STAMP_TAIL_SIZE = 64 * 1024;
+// Number of leading bytes inspected by 'FileUtil::isBinary'
+static constexpr qint64 SNIFF_SIZE = 8 * 1024;
+// Percentage of invalid UTF-8 bytes above which a file is treated as binary
+static constexpr int MAX_INVALID_PERCENT = 5;
 
 QString FileUtil::readAll(const QString &path) {
     QFile file{path};
@@ -17,15 +43,226 @@ QString FileUtil::readAll(const QString &path) {
     return content;
 }
 
-void FileUtil::writeAll(const QString &path, const QString &text) {
-    QFile file{path};
+bool FileUtil::writeAll(const QString &path, const QString &text) {
+    QSaveFile file{path};
 
     // If the file fails to open, exit the function
     if (!file.open(QFile::WriteOnly | QFile::Text)) {
-        return;
+        return false;
     }
 
-    // Write to file
+    // Write to a temporary file, then replace the original in one step
     file.write(text.toUtf8());
+    return file.commit();
+}
+
+bool FileUtil::append(const QString &path, const QString &text) {
+    QFile file{path};
+
+    // If the file fails to open, exit the function
+    if (!file.open(QFile::WriteOnly | QFile::Append | QFile::Text)) {
+        return false;
+    }
+
+    // Write to the end of the file
+    const QByteArray &bytes = text.toUtf8();
+    bool ok = file.write(bytes) == bytes.size() && file.flush();
     file.close();
+
+    return ok;
+}
+
+QByteArray FileUtil::readStdin(qint64 maxSize) {
+    QByteArray chunk{maxSize, Qt::Uninitialized};
+
+#ifdef Q_OS_WINDOWS
+    // Read raw bytes, without converting line endings
+    _setmode(_fileno(stdin), _O_BINARY);
+    const qint64 count = _read(_fileno(stdin), chunk.data(), unsigned(maxSize));
+#else
+    qint64 count;
+    do {
+        count = ::read(STDIN_FILENO, chunk.data(), size_t(maxSize));
+    } while (count < 0 && errno == EINTR);
+#endif
+
+    chunk.resize(qMax<qint64>(count, 0));
+    return chunk;
+}
+
+bool FileUtil::isBinary(const QString &path) {
+    QFile file{path};
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    const QByteArray sample{file.read(SNIFF_SIZE)};
+    const bool truncated = !file.atEnd();
+    file.close();
+
+    // Text files never contain NUL bytes
+    if (sample.contains('\0')) {
+        return true;
+    }
+
+    // Count the bytes that do not form a valid UTF-8 sequence
+    const auto *data = reinterpret_cast<const uchar *>(sample.constData());
+    const qsizetype size = sample.size();
+    qsizetype invalid = 0;
+
+    for (qsizetype i = 0; i < size;) {
+        const uchar lead = data[i];
+        int length = lead < 0x80 ? 1 :
+                     (lead & 0xE0) == 0xC0 ? 2 :
+                     (lead & 0xF0) == 0xE0 ? 3 :
+                     (lead & 0xF8) == 0xF0 ? 4 : 0;
+
+        // A sequence cut off by the end of the sample is not an error
+        if (length > 1 && i + length > size && truncated) {
+            break;
+        }
+
+        bool valid = length > 0 && i + length <= size;
+        for (int j = 1; valid && j < length; ++j) {
+            valid = (data[i + j] & 0xC0) == 0x80;
+        }
+
+        if (valid) {
+            i += length;
+        } else {
+            ++invalid;
+            ++i;
+        }
+    }
+
+    return invalid * 100 > size * MAX_INVALID_PERCENT;
+}
+
+bool FileUtil::hasNativeLineEnds(const QString &path) {
+    QFile file{path};
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    // Find the first line break without the text mode conversion
+    char last = 0;
+    while (!file.atEnd()) {
+        const QByteArray chunk{file.read(SNIFF_SIZE)};
+        if (chunk.isEmpty()) {
+            break;
+        }
+
+        const qsizetype index = chunk.indexOf('\n');
+        if (index >= 0) {
+            // The carriage return may end the previous chunk
+            const bool crlf = (index > 0 ? chunk[index - 1] : last) == '\r';
+#ifdef Q_OS_WINDOWS
+            return crlf;
+#else
+            return !crlf;
+#endif
+        }
+        last = chunk.back();
+    }
+
+    return true;
+}
+
+QStringList FileUtil::listFiles(const QString &dir, int &maxCount,
+                                qint64 &maxSize, bool &truncated) {
+    QStringList paths;
+    QDirIterator it{dir, QDir::Files | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories};
+    while (it.hasNext()) {
+        // Do not walk a whole drive when only a few files can be opened
+        if (paths.size() > maxCount * 16) {
+            truncated = true;
+            break;
+        }
+        paths.append(it.next());
+    }
+    // The iteration order depends on the file system
+    paths.sort();
+
+    QStringList files;
+    for (const auto &path : std::as_const(paths)) {
+        const qint64 size = QFileInfo{path}.size();
+        if (maxCount <= 0 || size > maxSize) {
+            truncated = true;
+            continue;
+        }
+        maxCount--;
+        maxSize -= size;
+        files.append(path);
+    }
+    return files;
+}
+
+FileId FileUtil::fileId(const QString &path) {
+    FileId id;
+#ifdef Q_OS_WINDOWS
+    // Opening with backup semantics reads the attributes without locking
+    const HANDLE handle = CreateFileW(reinterpret_cast<LPCWSTR>(path.utf16()), 0,
+                                      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                      nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return id;
+    }
+    BY_HANDLE_FILE_INFORMATION info;
+    if (GetFileInformationByHandle(handle, &info)) {
+        id.device = info.dwVolumeSerialNumber;
+        id.inode = (quint64(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    }
+    CloseHandle(handle);
+#else
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) == 0) {
+        id.device = st.st_dev;
+        id.inode = st.st_ino;
+    }
+#endif
+    return id;
+}
+
+QString FileUtil::canonicalPath(const QString &path) {
+    const QFileInfo info{path};
+    const QString &canonical = info.canonicalFilePath();
+    if (!canonical.isEmpty()) {
+        return canonical;
+    }
+
+    // The file does not exist, but its directory may
+    const QString &dir = info.absoluteDir().canonicalPath();
+    if (!dir.isEmpty()) {
+        return dir + "/" + info.fileName();
+    }
+    return QDir::cleanPath(info.absoluteFilePath());
+}
+
+FileStamp FileUtil::stamp(const QString &path) {
+    FileStamp stamp;
+
+    QFile file{path};
+    if (!file.open(QFile::ReadOnly)) {
+        return stamp;
+    }
+
+    const QFileInfo info{file};
+    stamp.size = info.size();
+    stamp.modified = info.lastModified();
+
+    // Only hash the tail, so the cost does not grow with the file size
+    file.seek(qMax<qint64>(0, stamp.size - STAMP_TAIL_SIZE));
+    stamp.tailHash = QCryptographicHash::hash(file.read(STAMP_TAIL_SIZE),
+                                              QCryptographicHash::Sha1);
+    file.close();
+
+    return stamp;
+}
+
+QString FileUtil::dataDir(const QString &name) {
+    const QString &dir =
+        QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/" + name;
+    QDir{}.mkpath(dir);
+    return dir;
 }
@@ -1,6 +1,45 @@
 #pragma once
 
 #include <QString>
+#include <QStringList>
+#include <QDateTime>
+#include <QHashFunctions>
+
+/**
+ * @brief Identifies the on-disk state of a file without reading all of it.
+ */
+struct FileStamp {
+    /// File size in bytes, or -1 if the file does not exist.
+    qint64 size{-1};
+    /// Last modification time.
+    QDateTime modified;
+    /// Hash of the last few kilobytes of the file.
+    QByteArray tailHash;
+
+    bool operator==(const FileStamp &other) const = default;
+};
+
+/**
+ * @brief Identifies a file on disk, whatever path leads to it.
+ */
+struct FileId {
+    /// Device, or volume, that holds the file.
+    quint64 device{0};
+    /// Index of the file on its device, or 0 if the file does not exist.
+    quint64 inode{0};
+
+    bool operator==(const FileId &other) const = default;
+
+    /**
+     * @brief Checks whether the file exists.
+     * @return true if the identity is known; false otherwise.
+     */
+    bool isValid() const { return inode != 0; }
+};
+
+inline size_t qHash(const FileId &id, size_t seed = 0) {
+    return qHashMulti(seed, id.device, id.inode);
+}
 
 /**
  * @brief Contains file utilities.
@@ -16,8 +55,90 @@ public:
 
     /**
      * @brief Writes the specified text to a file.
+     * @note The file is replaced atomically,
+     * so a failed write never leaves a truncated file behind.
      * @param path The file path.
      * @param text The text to be written.
+     * @return Whether the file is written successfully.
+     */
+    static bool writeAll(const QString &path, const QString &text);
+
+    /**
+     * @brief Appends the specified text to the end of a file.
+     * @param path The file path.
+     * @param text The text to be appended.
+     * @return Whether the text is appended successfully.
+     */
+    static bool append(const QString &path, const QString &text);
+
+    /**
+     * @brief Reads the next chunk of the standard input.
+     * @note Blocks until some data is available, then returns without
+     * waiting for the chunk to fill up.
+     * @param maxSize The maximum chunk size in bytes.
+     * @return The chunk, or an empty chunk at the end of the input.
+     */
+    static QByteArray readStdin(qint64 maxSize = 64 * 1024);
+
+    /**
+     * @brief Guesses whether a file holds binary data rather than text.
+     * @note Only a small sample at the start of the file is inspected.
+     * @param path The file path.
+     * @return true if the sample contains NUL bytes or too many
+     * invalid UTF-8 sequences; false otherwise.
+     */
+    static bool isBinary(const QString &path);
+
+    /**
+     * @brief Checks whether a file ends its lines the way this platform
+     * writes text files, which is CRLF on Windows and LF elsewhere.
+     * @note Only the first line break of the file is inspected.
+     * @param path The file path.
+     * @return true if the first line break is native, or there is none;
+     * false otherwise.
+     */
+    static bool hasNativeLineEnds(const QString &path);
+
+    /**
+     * @brief Lists the files in a directory and its subdirectories.
+     * @note Stops once either budget runs out, so dropping a huge
+     * directory cannot open thousands of windows.
+     * @param dir The directory path.
+     * @param maxCount The number of files left to list, which is reduced.
+     * @param maxSize The total size left to list, which is reduced.
+     * @param truncated Set to true if any file was left out.
+     * @return The full paths of the files, in a stable order.
+     */
+    static QStringList listFiles(const QString &dir, int &maxCount,
+                                 qint64 &maxSize, bool &truncated);
+
+    /**
+     * @brief Identifies a file by its device and inode, so that symbolic
+     * and hard links to the same file are recognized.
+     * @param path The file path.
+     * @return The identity, which is invalid if the file does not exist.
+     */
+    static FileId fileId(const QString &path);
+
+    /**
+     * @brief Resolves a path without '.', '..' or symbolic links.
+     * @note For a file that does not exist yet, its directory is resolved.
+     * @param path The file path.
+     * @return The canonical path.
+     */
+    static QString canonicalPath(const QString &path);
+
+    /**
+     * @brief Takes a cheap fingerprint of a file on disk.
+     * @param path The file path.
+     * @return The size, modification time and tail hash of the file.
+     */
+    static FileStamp stamp(const QString &path);
+
+    /**
+     * @brief Provides a directory for program data, creating it if needed.
+     * @param name The name of the directory.
+     * @return The full path of the directory.
      */
-    static void writeAll(const QString &path, const QString &text);
+    static QString dataDir(const QString &name);
 };
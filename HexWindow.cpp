@@ -0,0 +1,420 @@
+#include "HexWindow.h"
+#include "AppInfo.h"
+#include "Attr.h"
+
+#include <QApplication>
+#include <QFileInfo>
+#include <QMenuBar>
+#include <QStatusBar>
+#include <QScrollBar>
+#include <QPainter>
+#include <QMouseEvent>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <QRegularExpression>
+#include <QShortcut>
+
+#include <limits>
+
+QHash<FileId, HexWindow *> HexWindow::idIndex;
+QHash<QString, HexWindow *> HexWindow::pathIndex;
+
+HexWindow::HexWindow(const QString &path) : filePath{path} {
+    // Register this instance
+    registerFile();
+
+    resize(1080, 720);
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(QFileInfo{path}.fileName() + " [" + tr("Hex") + "] - " +
+                   AppInfo::name());
+
+    // Place the hex view in the center
+    view = new HexView{path, this};
+    connect(view, &HexView::positionChanged, this, &HexWindow::updatePos);
+    setCentralWidget(view);
+
+    makeMenus();
+
+    // Display the selected offset on the bottom
+    posLabel = new QLabel{this};
+    statusBar()->setSizeGripEnabled(false);
+    statusBar()->addPermanentWidget(posLabel);
+    updatePos();
+
+    show();
+    raise();
+    activateWindow();
+
+    // Use <Cmd+W> to close window in macOS
+    auto *closeShortcut = new QShortcut{QKeySequence::Close, this};
+    connect(closeShortcut, &QShortcut::activated, this, &HexWindow::close);
+
+    if (!view->isValid()) {
+        QMessageBox::critical(this, AppInfo::name(),
+                              tr("Unable to open %0!").arg(path));
+    }
+}
+
+void HexWindow::open(const QString &path) {
+    // If a file is already opened in another window, switch to that window
+    if (auto win = findWindow(path)) {
+        win->activate();
+        return;
+    }
+
+    new HexWindow(path);
+}
+
+HexWindow *HexWindow::findWindow(const QString &path) {
+    // Links and renamed parent directories lead to the same identity
+    const FileId &id = FileUtil::fileId(path);
+    if (id.isValid()) {
+        if (auto win = idIndex.value(id)) {
+            return win;
+        }
+    }
+    return pathIndex.value(FileUtil::canonicalPath(path));
+}
+
+void HexWindow::activate() {
+    show();
+    raise();
+    activateWindow();
+}
+
+void HexWindow::closeEvent(QCloseEvent *event) {
+    unregisterFile();
+    QMainWindow::closeEvent(event);
+}
+
+void HexWindow::registerFile() {
+    unregisterFile();
+    fileId = FileUtil::fileId(filePath);
+    canonicalPath = FileUtil::canonicalPath(filePath);
+    if (fileId.isValid()) {
+        idIndex.insert(fileId, this);
+    }
+    pathIndex.insert(canonicalPath, this);
+}
+
+void HexWindow::unregisterFile() {
+    // Only remove the entries that still point to this window
+    if (fileId.isValid() && idIndex.value(fileId) == this) {
+        idIndex.remove(fileId);
+    }
+    if (!canonicalPath.isEmpty() && pathIndex.value(canonicalPath) == this) {
+        pathIndex.remove(canonicalPath);
+    }
+    fileId = {};
+    canonicalPath.clear();
+}
+
+void HexWindow::makeMenus() {
+    auto fileMenu = menuBar()->addMenu(tr("&File"));
+    fileMenu->addAction(tr("&Close"), this, &HexWindow::close);
+
+    auto editMenu = menuBar()->addMenu(tr("&Edit"));
+    editMenu->addAction(tr("&Find..."), QKeySequence("Ctrl+F"), this, &HexWindow::find);
+    editMenu->addAction(tr("Find &Next"), QKeySequence("F3"), this, &HexWindow::findNext);
+    editMenu->addSeparator();
+    editMenu->addAction(tr("&Go To..."), QKeySequence("Ctrl+G"), this, &HexWindow::goTo);
+}
+
+void HexWindow::goTo() {
+    bool ok;
+    QString text = QInputDialog::getText(
+        this, tr("Go To"), tr("Offset (decimal, or hexadecimal with 0x):"),
+        QLineEdit::Normal, "0x" + QString::number(view->position(), 16), &ok).trimmed();
+
+    // Exit the function if the user closes the dialog
+    if (!ok || text.isEmpty()) {
+        return;
+    }
+
+    qint64 offset;
+    if (text.startsWith("0x", Qt::CaseInsensitive)) {
+        offset = text.mid(2).toLongLong(&ok, 16);
+    } else {
+        offset = text.toLongLong(&ok, 10);
+    }
+
+    if (!ok || offset < 0 || offset >= view->fileSize()) {
+        QMessageBox::critical(this, AppInfo::name(), tr("Invalid offset!"));
+        return;
+    }
+
+    view->select(offset);
+}
+
+void HexWindow::find() {
+    bool ok;
+    const QString text = QInputDialog::getText(
+        this, tr("Find"), tr("Hex bytes (e.g. DE AD BE EF) or text:"),
+        QLineEdit::Normal, QString::fromLatin1(pattern.toHex(' ')), &ok);
+
+    // Exit the function if the user closes the dialog
+    if (!ok || text.isEmpty()) {
+        return;
+    }
+
+    // Treat pairs of hex digits as bytes, and anything else as UTF-8 text
+    static const QRegularExpression hexEx{"^\\s*([0-9A-Fa-f]{2}\\s*)+$"};
+    if (hexEx.match(text).hasMatch()) {
+        pattern = QByteArray::fromHex(text.toLatin1());
+    } else {
+        pattern = text.toUtf8();
+    }
+
+    findNext();
+}
+
+void HexWindow::findNext() {
+    if (pattern.isEmpty()) {
+        find();
+        return;
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const qint64 offset = view->indexOf(pattern);
+    QApplication::restoreOverrideCursor();
+
+    // If the pattern is not found, display an error message
+    if (offset < 0) {
+        QMessageBox::critical(this, AppInfo::name(),
+                              tr("'%0' not found!").arg(QString::fromLatin1(pattern.toHex(' '))));
+        return;
+    }
+
+    view->select(offset, pattern.size());
+}
+
+void HexWindow::updatePos() {
+    posLabel->setText(tr("Offset 0x%0 (%1) of %2 bytes")
+                      .arg(QString::number(view->position(), 16).toUpper())
+                      .arg(view->position())
+                      .arg(view->fileSize()));
+}
+
+HexView::HexView(const QString &path, QWidget *parent)
+    : QAbstractScrollArea{parent}, file{path}, data{nullptr}, mappedSize{0},
+      selStart{0}, selLength{0}, rowsPerStep{1} {
+    mapFile();
+
+    // Use the editor font, which is monospaced
+    QFont font{Attr::get().editorFont};
+    font.setStyleHint(QFont::Monospace);
+    setFont(font);
+
+    updateScrollBar();
+}
+
+HexView::~HexView() {
+    if (data) {
+        file.unmap(const_cast<uchar *>(data));
+    }
+    file.close();
+}
+
+bool HexView::isValid() const {
+    return data != nullptr;
+}
+
+void HexView::mapFile() {
+    // Map the file instead of reading it, so memory usage stays constant
+    if (file.open(QFile::ReadOnly) && file.size() > 0) {
+        mappedSize = file.size();
+        data = file.map(0, mappedSize);
+    }
+    if (!data) {
+        mappedSize = 0;
+    }
+}
+
+void HexView::checkFile() {
+    if (!file.isOpen() || QFileInfo{file.fileName()}.size() == mappedSize) {
+        return;
+    }
+
+    // Show the file as it is now, rather than read past its end
+    if (data) {
+        file.unmap(const_cast<uchar *>(data));
+        data = nullptr;
+    }
+    file.close();
+    mapFile();
+
+    selStart = qBound<qint64>(0, selStart, qMax<qint64>(0, fileSize() - 1));
+    selLength = qMin(selLength, fileSize() - selStart);
+    updateScrollBar();
+    viewport()->update();
+    emit positionChanged();
+}
+
+qint64 HexView::fileSize() const {
+    return mappedSize;
+}
+
+qint64 HexView::position() const {
+    return selStart;
+}
+
+void HexView::select(qint64 offset, qint64 length) {
+    selStart = qBound<qint64>(0, offset, qMax<qint64>(0, fileSize() - 1));
+    selLength = qMin(length, fileSize() - selStart);
+
+    // Scroll the selection into view if it is off screen
+    const qint64 row = selStart / ROW_SIZE;
+    if (row < topRow() || row >= topRow() + visibleRows()) {
+        const qint64 top = qMax<qint64>(0, row - visibleRows() / 3);
+        verticalScrollBar()->setValue(static_cast<int>(top / rowsPerStep));
+    }
+
+    viewport()->update();
+    emit positionChanged();
+}
+
+qint64 HexView::indexOf(const QByteArray &pattern) {
+    checkFile();
+    if (!data || pattern.isEmpty()) {
+        return -1;
+    }
+
+    const QByteArrayView all{reinterpret_cast<const char *>(data), fileSize()};
+
+    // Search after the selection first
+    qint64 offset = all.indexOf(pattern, selStart + 1);
+    if (offset >= 0) {
+        return offset;
+    }
+
+    // If not found, try again from the beginning of the file
+    const qint64 end = qMin(fileSize(), selStart + pattern.size());
+    return all.first(end).indexOf(pattern);
+}
+
+bool HexView::viewportEvent(QEvent *event) {
+    // Painting and the mouse read the mapped content
+    checkFile();
+    return QAbstractScrollArea::viewportEvent(event);
+}
+
+void HexView::paintEvent(QPaintEvent *) {
+    QPainter painter{viewport()};
+    if (!data) {
+        return;
+    }
+
+    const QFontMetrics &metrics = fontMetrics();
+    const int charWidth = metrics.horizontalAdvance('0');
+    const int lineHeight = metrics.height();
+    const int digits = offsetDigits();
+
+    // Column positions of each section, in characters
+    const int hexColumn = digits + 2;
+    const int asciiColumn = hexColumn + ROW_SIZE * 3 + 1;
+
+    const QPalette &pal = palette();
+    const qint64 first = topRow();
+    const qint64 last = qMin(rowCount(), first + visibleRows() + 1);
+    const int xOffset = -horizontalScrollBar()->value();
+
+    QString hex, ascii;
+    hex.reserve(ROW_SIZE * 3);
+    ascii.reserve(ROW_SIZE);
+
+    // Only the rows on screen are rendered
+    for (qint64 row = first; row < last; ++row) {
+        const int y = static_cast<int>(row - first) * lineHeight;
+        const qint64 start = row * ROW_SIZE;
+        const int count = static_cast<int>(qMin<qint64>(ROW_SIZE, fileSize() - start));
+
+        // Highlight the selected bytes
+        const qint64 selEnd = selStart + qMax<qint64>(selLength, 1);
+        for (int i = 0; i < count; ++i) {
+            if (start + i >= selStart && start + i < selEnd) {
+                const QColor &color = pal.color(QPalette::Highlight);
+                painter.fillRect(xOffset + (hexColumn + i * 3) * charWidth, y,
+                                 charWidth * 2, lineHeight, color);
+                painter.fillRect(xOffset + (asciiColumn + i) * charWidth, y,
+                                 charWidth, lineHeight, color);
+            }
+        }
+
+        hex.clear();
+        ascii.clear();
+        for (int i = 0; i < count; ++i) {
+            const uchar byte = data[start + i];
+            hex += QString::number(byte, 16).rightJustified(2, '0').toUpper() + ' ';
+            ascii += (byte >= 0x20 && byte < 0x7F) ? QChar{char16_t(byte)} : QChar{'.'};
+        }
+
+        const QString &offset =
+            QString::number(start, 16).rightJustified(digits, '0').toUpper();
+
+        painter.setPen(pal.color(QPalette::PlaceholderText));
+        painter.drawText(xOffset, y + metrics.ascent(), offset);
+        painter.setPen(pal.color(QPalette::Text));
+        painter.drawText(xOffset + hexColumn * charWidth, y + metrics.ascent(), hex);
+        painter.drawText(xOffset + asciiColumn * charWidth, y + metrics.ascent(), ascii);
+    }
+}
+
+void HexView::resizeEvent(QResizeEvent *event) {
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBar();
+}
+
+void HexView::mousePressEvent(QMouseEvent *event) {
+    const int charWidth = fontMetrics().horizontalAdvance('0');
+    const int hexColumn = offsetDigits() + 2;
+    const int asciiColumn = hexColumn + ROW_SIZE * 3 + 1;
+
+    const int x = event->position().toPoint().x() + horizontalScrollBar()->value();
+    const int column = x / charWidth;
+    const qint64 row = topRow() + event->position().toPoint().y() / fontMetrics().height();
+
+    // Map the clicked column to a byte in the hex or ASCII section
+    int index = -1;
+    if (column >= hexColumn && column < hexColumn + ROW_SIZE * 3) {
+        index = (column - hexColumn) / 3;
+    } else if (column >= asciiColumn && column < asciiColumn + ROW_SIZE) {
+        index = column - asciiColumn;
+    }
+
+    if (index >= 0 && row * ROW_SIZE + index < fileSize()) {
+        select(row * ROW_SIZE + index);
+    }
+}
+
+qint64 HexView::rowCount() const {
+    return (fileSize() + ROW_SIZE - 1) / ROW_SIZE;
+}
+
+qint64 HexView::topRow() const {
+    return static_cast<qint64>(verticalScrollBar()->value()) * rowsPerStep;
+}
+
+int HexView::visibleRows() const {
+    return qMax(1, viewport()->height() / fontMetrics().height());
+}
+
+int HexView::offsetDigits() const {
+    // Files over 4 GB need more than 8 digits
+    return fileSize() > 0xFFFFFFFFLL ? 12 : 8;
+}
+
+void HexView::updateScrollBar() {
+    // Scroll bars are limited to int, so very large files
+    // scroll by several rows per step
+    const qint64 rows = rowCount();
+    rowsPerStep = static_cast<int>(rows / std::numeric_limits<int>::max() + 1);
+
+    const qint64 maxRow = qMax<qint64>(0, rows - visibleRows());
+    verticalScrollBar()->setRange(0, static_cast<int>(maxRow / rowsPerStep));
+    verticalScrollBar()->setPageStep(qMax(1, visibleRows() / rowsPerStep));
+
+    const int charWidth = fontMetrics().horizontalAdvance('0');
+    const int width = (offsetDigits() + 2 + ROW_SIZE * 4 + 1) * charWidth;
+    horizontalScrollBar()->setRange(0, qMax(0, width - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include "FileUtil.h"
+
+#include <QMainWindow>
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QLabel>
+#include <QHash>
+
+// Forward declarations
+class HexView;
+
+/**
+ * @brief Displays a binary file as read-only hexadecimal rows.
+ */
+class HexWindow : public QMainWindow {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Opens a binary file in a hex window.
+     * @note If the file is already opened, switches to that window.
+     * @param path The full file path.
+     */
+    static void open(const QString &path);
+
+    /**
+     * @brief Checks whether a file is opened in a hex window.
+     * @param path The full file path.
+     * @return The hex window that displays the file, or nullptr.
+     */
+    static HexWindow *findWindow(const QString &path);
+
+    /**
+     * @brief Shows this window on top of the others.
+     */
+    void activate();
+
+protected:
+    void closeEvent(QCloseEvent *event) override;
+
+private:
+    HexView *view;
+    QLabel *posLabel;
+
+    QString filePath;   // The file path
+    QByteArray pattern; // The last searched byte pattern
+
+    FileId fileId;          // Identity of the file in the registry
+    QString canonicalPath;  // Canonical path of the file in the registry
+
+    // Find the window of an opened file by its identity or canonical path,
+    // the same way as text windows
+    static QHash<FileId, HexWindow *> idIndex;
+    static QHash<QString, HexWindow *> pathIndex;
+
+    /**
+     * @brief Initializes a new 'HexWindow' instance.
+     * @param path The full file path.
+     */
+    HexWindow(const QString &path);
+
+    /**
+     * @brief Creates the menus and actions of this window.
+     */
+    void makeMenus();
+
+    /**
+     * @brief Prompts the user to go to a specific byte offset.
+     */
+    void goTo();
+
+    /**
+     * @brief Prompts the user to enter a byte pattern to search for.
+     */
+    void find();
+
+    /**
+     * @brief Finds the next occurrence of the last searched byte pattern.
+     */
+    void findNext();
+
+    /**
+     * @brief Updates the offset displayed in the status bar.
+     */
+    void updatePos();
+
+    /**
+     * @brief Indexes the opened file.
+     */
+    void registerFile();
+
+    /**
+     * @brief Removes the opened file from the index.
+     */
+    void unregisterFile();
+};
+
+/**
+ * @brief Renders the rows of a memory-mapped file that are on screen.
+ */
+class HexView : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+    /// Number of bytes displayed on each row.
+    static constexpr int ROW_SIZE = 16;
+
+    /**
+     * @brief Initializes a new 'HexView' instance.
+     * @param path The file path.
+     * @param parent The parent widget.
+     */
+    HexView(const QString &path, QWidget *parent);
+    ~HexView();
+
+    /**
+     * @brief Checks whether the file is mapped into memory.
+     * @return true if the file content is available; false otherwise.
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Provides the size of the file.
+     * @return The file size in bytes.
+     */
+    qint64 fileSize() const;
+
+    /**
+     * @brief Provides the offset of the selected byte range.
+     * @return The offset of the first selected byte.
+     */
+    qint64 position() const;
+
+    /**
+     * @brief Selects a byte range and scrolls it into view.
+     * @param offset The offset of the first byte.
+     * @param length The number of selected bytes.
+     */
+    void select(qint64 offset, qint64 length = 1);
+
+    /**
+     * @brief Searches for a byte pattern after the selection,
+     * wrapping around to the beginning of the file.
+     * @param pattern The byte pattern.
+     * @return The offset of the match, or -1 if not found.
+     */
+    qint64 indexOf(const QByteArray &pattern);
+
+signals:
+    /**
+     * @brief Emitted when the selected byte range changes.
+     */
+    void positionChanged();
+
+protected:
+    bool viewportEvent(QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+
+private:
+    QFile file;
+    const uchar *data;  // The mapped file content
+    qint64 mappedSize;  // Number of mapped bytes
+
+    qint64 selStart;    // Offset of the first selected byte
+    qint64 selLength;   // Number of selected bytes
+    int rowsPerStep;    // Rows per scroll bar step, for files over 32 GB
+
+    /**
+     * @brief Maps the file into memory.
+     */
+    void mapFile();
+
+    /**
+     * @brief Maps the file again if another program resized it.
+     * @note Reading the pages past the end of a truncated file crashes,
+     * so this is checked before the mapped content is read.
+     */
+    void checkFile();
+
+    /**
+     * @brief Provides the total number of rows.
+     * @return The number of rows.
+     */
+    qint64 rowCount() const;
+
+    /**
+     * @brief Provides the row displayed on the top of the viewport.
+     * @return The top row.
+     */
+    qint64 topRow() const;
+
+    /**
+     * @brief Provides the number of rows that fit in the viewport.
+     * @return The number of visible rows.
+     */
+    int visibleRows() const;
+
+    /**
+     * @brief Provides the number of hex digits in the offset column.
+     * @return The width of the offset column in characters.
+     */
+    int offsetDigits() const;
+
+    /**
+     * @brief Updates the scroll bar range after resizing or font change.
+     */
+    void updateScrollBar();
+};
@@ -0,0 +1,265 @@
+#include "History.h"
+#include "FileUtil.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QSaveFile>
+#include <QSet>
+#include <QThreadPool>
+
+#include <array>
+
+// Version of the manifest format
+static constexpr quint32 MANIFEST_VERSION = 1;
+// Chunk size limits; cut points are chosen by content in between
+static constexpr qint64 MIN_CHUNK = 16 * 1024;
+static constexpr qint64 MAX_CHUNK = 256 * 1024;
+// Cut when the rolling hash matches this mask, averaging 64 KiB chunks
+static constexpr quint64 CHUNK_MASK = 0xFFFF000000000000ULL;
+// Retention limits of each file
+static constexpr int MAX_VERSIONS = 50;
+static constexpr int MAX_AGE_DAYS = 90;
+
+/**
+ * @brief Provides the random table of the gear rolling hash.
+ * @return The gear table.
+ */
+static const std::array<quint64, 256> &gearTable() {
+    static const auto table = [] {
+        // A fixed seed keeps the cut points stable between runs
+        std::array<quint64, 256> table;
+        quint64 seed = 0x9E3779B97F4A7C15ULL;
+        for (auto &value : table) {
+            seed += 0x9E3779B97F4A7C15ULL;
+            quint64 z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            value = z ^ (z >> 31);
+        }
+        return table;
+    }();
+    return table;
+}
+
+/**
+ * @brief Finds the end of the chunk that starts at the beginning of the data.
+ * @param data The remaining data.
+ * @param size The number of remaining bytes.
+ * @return The chunk size.
+ */
+static qint64 nextCut(const uchar *data, qint64 size) {
+    if (size <= MIN_CHUNK) {
+        return size;
+    }
+
+    const auto &gear = gearTable();
+    const qint64 end = qMin(size, MAX_CHUNK);
+    quint64 hash = 0;
+    for (qint64 i = 0; i < end; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if (i >= MIN_CHUNK && (hash & CHUNK_MASK) == 0) {
+            return i + 1;
+        }
+    }
+    return end;
+}
+
+/**
+ * @brief Reads the manifest of a version.
+ * @param file The manifest path.
+ * @param version Receives the version description.
+ * @param chunks Receives the chunk hashes, if not null.
+ * @return Whether the manifest is valid.
+ */
+static bool readManifest(const QString &file, History::Version &version,
+                         QList<QByteArray> *chunks) {
+    QFile manifest{file};
+    if (!manifest.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in{&manifest};
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 format;
+    QString path;
+    QList<QByteArray> hashes;
+    in >> format >> path >> version.time >> version.size >> hashes;
+    version.id = QFileInfo{file}.completeBaseName();
+
+    if (chunks) {
+        *chunks = hashes;
+    }
+    return in.status() == QDataStream::Ok && format == MANIFEST_VERSION;
+}
+
+void History::record(const QString &path) {
+    pool()->start([path] {
+        store(path);
+        prune(path);
+    });
+}
+
+QList<History::Version> History::versions(const QString &path) {
+    QList<Version> list;
+
+    const QDir dir{versionDir(path)};
+    const auto names = dir.entryList({"*.ver"}, QDir::Files, QDir::Name | QDir::Reversed);
+    for (const auto &name : names) {
+        Version version;
+        if (readManifest(dir.filePath(name), version, nullptr)) {
+            list.append(version);
+        }
+    }
+
+    return list;
+}
+
+QByteArray History::load(const QString &path, const QString &id) {
+    Version version;
+    QList<QByteArray> chunks;
+    if (!readManifest(versionDir(path) + "/" + id + ".ver", version, &chunks)) {
+        return {};
+    }
+
+    QByteArray content;
+    content.reserve(version.size);
+    for (const auto &hash : std::as_const(chunks)) {
+        QFile chunk{chunkPath(hash)};
+        if (!chunk.open(QFile::ReadOnly)) {
+            return {};
+        }
+        content += qUncompress(chunk.readAll());
+    }
+
+    return content;
+}
+
+QThreadPool *History::pool() {
+    // A single thread keeps recording and pruning in order
+    static QThreadPool *pool = [] {
+        auto pool = new QThreadPool;
+        pool->setMaxThreadCount(1);
+        return pool;
+    }();
+    return pool;
+}
+
+QString History::versionDir(const QString &path) {
+    const QByteArray &key =
+        QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return FileUtil::dataDir("history/versions/" + QString::fromLatin1(key));
+}
+
+QString History::chunkPath(const QByteArray &hash) {
+    const QString &hex = QString::fromLatin1(hash.toHex());
+    return FileUtil::dataDir("history/chunks/" + hex.left(2)) + "/" + hex;
+}
+
+void History::store(const QString &path) {
+    QFile file{path};
+    if (!file.open(QFile::ReadOnly)) {
+        return;
+    }
+
+    // Map the file, so large files are not copied into memory
+    const qint64 size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (size > 0 && !data) {
+        return;
+    }
+
+    // Store each chunk that is not stored yet
+    QList<QByteArray> chunks;
+    for (qint64 pos = 0; pos < size;) {
+        const qint64 length = nextCut(data + pos, size - pos);
+        const QByteArray chunk = QByteArray::fromRawData(
+            reinterpret_cast<const char *>(data + pos), length);
+        const QByteArray &hash = QCryptographicHash::hash(chunk, QCryptographicHash::Sha1);
+
+        const QString &target = chunkPath(hash);
+        if (!QFile::exists(target)) {
+            QSaveFile out{target};
+            if (out.open(QFile::WriteOnly)) {
+                out.write(qCompress(chunk, 1));
+                out.commit();
+            }
+        }
+
+        chunks.append(hash);
+        pos += length;
+    }
+    file.close();
+
+    // Skip the version if it is identical to the newest one
+    const QDir dir{versionDir(path)};
+    const auto names = dir.entryList({"*.ver"}, QDir::Files, QDir::Name | QDir::Reversed);
+    if (!names.isEmpty()) {
+        Version latest;
+        QList<QByteArray> latestChunks;
+        if (readManifest(dir.filePath(names.first()), latest, &latestChunks) &&
+            latestChunks == chunks) {
+            return;
+        }
+    }
+
+    // Name versions by time, so they sort chronologically
+    const QDateTime &now = QDateTime::currentDateTime();
+    QSaveFile manifest{dir.filePath(QString::number(now.toMSecsSinceEpoch()) + ".ver")};
+    if (!manifest.open(QFile::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out{&manifest};
+    out.setVersion(QDataStream::Qt_6_0);
+    out << MANIFEST_VERSION << path << now << size << chunks;
+    manifest.commit();
+}
+
+void History::prune(const QString &path) {
+    const QDir dir{versionDir(path)};
+    const auto names = dir.entryList({"*.ver"}, QDir::Files, QDir::Name | QDir::Reversed);
+    const qint64 oldest =
+        QDateTime::currentDateTime().addDays(-MAX_AGE_DAYS).toMSecsSinceEpoch();
+
+    // Always keep the newest version
+    bool pruned = false;
+    for (int i = 1; i < names.size(); ++i) {
+        const qint64 time = QFileInfo{names[i]}.completeBaseName().toLongLong();
+        if (i >= MAX_VERSIONS || time < oldest) {
+            pruned = dir.remove(names[i]) || pruned;
+        }
+    }
+
+    if (!pruned) {
+        return;
+    }
+
+    // Collect the chunks referenced by any version of any file
+    QSet<QString> used;
+    QDirIterator versionIt{FileUtil::dataDir("history/versions"), {"*.ver"},
+                           QDir::Files, QDirIterator::Subdirectories};
+    while (versionIt.hasNext()) {
+        Version version;
+        QList<QByteArray> chunks;
+        if (!readManifest(versionIt.next(), version, &chunks)) {
+            continue;
+        }
+        for (const auto &hash : std::as_const(chunks)) {
+            used.insert(QString::fromLatin1(hash.toHex()));
+        }
+    }
+
+    // Delete the rest
+    QDirIterator chunkIt{FileUtil::dataDir("history/chunks"),
+                         QDir::Files, QDirIterator::Subdirectories};
+    while (chunkIt.hasNext()) {
+        const QString &chunk = chunkIt.next();
+        if (!used.contains(QFileInfo{chunk}.fileName())) {
+            QFile::remove(chunk);
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QString>
+#include <QDateTime>
+#include <QList>
+
+// Forward declarations
+class QThreadPool;
+
+/**
+ * @brief Keeps a local history of saved file versions.
+ * @note Files are split into content-defined chunks, which are stored once
+ * by their hash, so saving a large file with small changes only stores the
+ * changed chunks. Recording and pruning run on a background thread.
+ */
+class History {
+public:
+    /**
+     * @brief Describes a recorded version of a file.
+     */
+    struct Version {
+        /// Unique name of the version.
+        QString id;
+        /// Time when the version was saved.
+        QDateTime time;
+        /// File size in bytes.
+        qint64 size;
+    };
+
+    /**
+     * @brief Records the current content of a file in the background.
+     * @param path The full file path.
+     */
+    static void record(const QString &path);
+
+    /**
+     * @brief Lists the recorded versions of a file.
+     * @param path The full file path.
+     * @return The versions, from newest to oldest.
+     */
+    static QList<Version> versions(const QString &path);
+
+    /**
+     * @brief Reassembles the content of a recorded version.
+     * @param path The full file path.
+     * @param id The name of the version.
+     * @return The file content of the version.
+     */
+    static QByteArray load(const QString &path, const QString &id);
+
+private:
+    History() = delete;     // Prevent instantiation
+
+    /**
+     * @brief Provides the thread pool that runs history tasks one at a time.
+     * @return The history thread pool.
+     */
+    static QThreadPool *pool();
+
+    /**
+     * @brief Provides the directory that holds the versions of a file.
+     * @param path The full file path.
+     * @return The version directory.
+     */
+    static QString versionDir(const QString &path);
+
+    /**
+     * @brief Provides the location of a chunk.
+     * @param hash The chunk hash.
+     * @return The chunk file path.
+     */
+    static QString chunkPath(const QByteArray &hash);
+
+    /**
+     * @brief Splits a file into chunks and stores a new version.
+     * @param path The full file path.
+     */
+    static void store(const QString &path);
+
+    /**
+     * @brief Deletes the versions beyond the retention limits,
+     * then the chunks no longer referenced by any version.
+     * @param path The full file path.
+     */
+    static void prune(const QString &path);
+};
@@ -0,0 +1,106 @@
+#include "IpcUtil.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QRegularExpression>
+
+// Identifies a batch message, as opposed to the plain commands
+static const QByteArray BATCH_MAGIC{"Batch"};
+// Version of the batch format
+static constexpr quint32 BATCH_VERSION = 2;
+// Identifies a chunk of a stream
+static const QByteArray STREAM_MAGIC{"Stream"};
+
+static QDataStream &operator<<(QDataStream &out, const FileTarget &target) {
+    return out << target.path << qint32(target.line) << qint32(target.column);
+}
+
+static QDataStream &operator>>(QDataStream &in, FileTarget &target) {
+    qint32 line, column;
+    in >> target.path >> line >> column;
+    target.line = line;
+    target.column = column;
+    return in;
+}
+
+QList<FileTarget> IpcUtil::parseTargets(const QStringList &args, const QString &dir) {
+    // Matches 'path:line', 'path:line:column', with an optional trailing ':'
+    static const QRegularExpression ex{"^(.+?):(\\d+)(?::(\\d+))?:?$"};
+    const QDir baseDir{dir};
+
+    QList<FileTarget> targets;
+    int nextLine = 0;
+    for (const auto &arg : args) {
+        // A '+line' argument applies to the next file
+        if (arg.size() > 1 && arg.startsWith('+')) {
+            bool ok;
+            const int line = arg.sliced(1).toInt(&ok);
+            if (ok) {
+                nextLine = line;
+                continue;
+            }
+        }
+
+        FileTarget target{arg, nextLine, 0};
+        nextLine = 0;
+
+        const auto &match = ex.match(arg);
+        if (match.hasMatch() && !QFileInfo::exists(baseDir.absoluteFilePath(arg))) {
+            target.path = match.captured(1);
+            target.line = match.captured(2).toInt();
+            target.column = match.captured(3).toInt();
+        }
+        targets.append(target);
+    }
+
+    return targets;
+}
+
+QByteArray IpcUtil::openMessage(const QString &dir, const QList<FileTarget> &targets) {
+    QByteArray message{BATCH_MAGIC};
+    QDataStream out{&message, QIODevice::Append};
+    out.setVersion(QDataStream::Qt_6_0);
+    out << BATCH_VERSION << dir << targets;
+    return message;
+}
+
+bool IpcUtil::readOpenMessage(const QByteArray &message,
+                              QString &dir, QList<FileTarget> &targets) {
+    if (!message.startsWith(BATCH_MAGIC)) {
+        return false;
+    }
+
+    QDataStream in{message.sliced(BATCH_MAGIC.size())};
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 version;
+    in >> version;
+    // Reject formats from newer versions of the program
+    if (in.status() != QDataStream::Ok || version != BATCH_VERSION) {
+        return false;
+    }
+
+    in >> dir >> targets;
+    return in.status() == QDataStream::Ok;
+}
+
+QByteArray IpcUtil::streamMessage(qint64 id, const QByteArray &data) {
+    QByteArray message{STREAM_MAGIC};
+    message.reserve(STREAM_MAGIC.size() + data.size() + 16);
+    QDataStream out{&message, QIODevice::Append};
+    out.setVersion(QDataStream::Qt_6_0);
+    out << id << data;
+    return message;
+}
+
+bool IpcUtil::readStreamMessage(const QByteArray &message,
+                                qint64 &id, QByteArray &data) {
+    if (!message.startsWith(STREAM_MAGIC)) {
+        return false;
+    }
+
+    QDataStream in{message.sliced(STREAM_MAGIC.size())};
+    in.setVersion(QDataStream::Qt_6_0);
+    in >> id >> data;
+    return in.status() == QDataStream::Ok;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QStringList>
+
+/**
+ * @brief Describes a file to open, optionally at a position.
+ */
+struct FileTarget {
+    /// The file path.
+    QString path;
+    /// The line to go to, starting from 1, or 0 to keep the default.
+    int line{0};
+    /// The column to go to, starting from 1, or 0 for the start of the line.
+    int column{0};
+};
+
+/**
+ * @brief Contains utilities for messages between program instances.
+ */
+class IpcUtil {
+public:
+    /**
+     * @brief Reads the files to open from the program arguments.
+     * @note Accepts 'path:line', 'path:line:column' and a '+line' argument
+     * that applies to the next file. A file whose name really ends with
+     * ':<number>' is opened as is.
+     * @param args The program arguments, without the program name.
+     * @param dir The directory that relative paths are resolved against.
+     * @return The files to open.
+     */
+    static QList<FileTarget> parseTargets(const QStringList &args, const QString &dir);
+
+    /**
+     * @brief Packs a request to open several files into a single message.
+     * @note Relative paths are resolved by the receiver against the
+     * directory of the sender, not its own working directory.
+     * @param dir The working directory of the sender.
+     * @param targets The files to open.
+     * @return The encoded message.
+     */
+    static QByteArray openMessage(const QString &dir, const QList<FileTarget> &targets);
+
+    /**
+     * @brief Unpacks a request to open several files.
+     * @param message The received message.
+     * @param dir Receives the working directory of the sender.
+     * @param targets Receives the files to open.
+     * @return Whether the message is a valid request to open files.
+     */
+    static bool readOpenMessage(const QByteArray &message,
+                                QString &dir, QList<FileTarget> &targets);
+
+    /**
+     * @brief Packs a chunk of a stream, such as the standard input.
+     * @param id The identifier of the stream, unique to the sender.
+     * @param data The chunk, or an empty chunk at the end of the stream.
+     * @return The encoded message.
+     */
+    static QByteArray streamMessage(qint64 id, const QByteArray &data);
+
+    /**
+     * @brief Unpacks a chunk of a stream.
+     * @param message The received message.
+     * @param id Receives the identifier of the stream.
+     * @param data Receives the chunk.
+     * @return Whether the message is a valid chunk of a stream.
+     */
+    static bool readStreamMessage(const QByteArray &message,
+                                  qint64 &id, QByteArray &data);
+
+private:
+    IpcUtil() = delete;     // Prevent instantiation
+};
@@ -0,0 +1,307 @@
+#include "Journal.h"
+#include "Editor.h"
+#include "FileUtil.h"
+
+#include <QApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QThread>
+#include <QUuid>
+
+#include <utility>
+
+// Types of journal records
+static constexpr quint8 HEADER_RECORD = 0;
+static constexpr quint8 EDIT_RECORD = 1;
+// Version of the journal format
+static constexpr quint32 JOURNAL_VERSION = 1;
+// Maximum interval between two flushes, in milliseconds
+static constexpr int FLUSH_INTERVAL = 1000;
+// Journal size above which the document is compacted into a snapshot
+static constexpr qint64 COMPACT_SIZE = 4 * 1024 * 1024;
+
+/**
+ * @brief Replaces the content of a file, or appends to it.
+ * @param path The file path.
+ * @param bytes The bytes to be written.
+ * @param append Whether to append instead of replacing.
+ */
+static void writeFile(const QString &path, const QByteArray &bytes, bool append) {
+    QFile file{path};
+    const QFile::OpenMode mode = append ? QFile::Append : QFile::Truncate;
+    if (file.open(QFile::WriteOnly | mode)) {
+        file.write(bytes);
+        file.close();
+    }
+}
+
+Journal::Journal(QTextDocument *doc, QObject *parent)
+    : QObject{parent}, doc{doc}, journalSize{0}, generation{0},
+      revision{doc->revision()}, discarded{false} {
+    // Give each journal a unique name
+    prefix = FileUtil::dataDir("journal") + "/" +
+             QUuid::createUuid().toString(QUuid::WithoutBraces);
+
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(FLUSH_INTERVAL);
+    connect(&flushTimer, &QTimer::timeout, this, &Journal::flush);
+
+    connect(doc, &QTextDocument::contentsChange, this, &Journal::record);
+}
+
+Journal::~Journal() {
+    // Keep the pending edits if the journal is still needed
+    if (discarded || buffer.isEmpty()) {
+        return;
+    }
+
+    const QString &journalPath = filePath("jnl");
+    const QByteArray bytes{buffer};
+    QMetaObject::invokeMethod(worker(), [journalPath, bytes] {
+        writeFile(journalPath, bytes, true);
+    });
+}
+
+void Journal::reset(const QString &path) {
+    discarded = false;
+
+    // Record edits again if the journal was paused
+    disconnect(doc, nullptr, this, nullptr);
+    connect(doc, &QTextDocument::contentsChange, this, &Journal::record);
+
+    this->path = path;
+    generation = 0;
+    journalSize = 0;
+    revision = doc->revision();
+    buffer.clear();
+    flushTimer.stop();
+
+    // Start over with only a header, based on the file on disk
+    const QString &journalPath = filePath("jnl");
+    const QString &snapPath = filePath("snap");
+    const QByteArray &head = header();
+    QMetaObject::invokeMethod(worker(), [journalPath, snapPath, head] {
+        writeFile(journalPath, head, false);
+        QFile::remove(snapPath);
+    });
+}
+
+void Journal::compact() {
+    flush();
+
+    ++generation;
+    journalSize = 0;
+
+    // The snapshot replaces every edit recorded so far
+    const QString &journalPath = filePath("jnl");
+    const QString &snapPath = filePath("snap");
+    const QByteArray &head = header();
+    const QString &text = Editor::fileText(doc);
+    const quint32 gen = generation;
+    QMetaObject::invokeMethod(worker(), [journalPath, snapPath, head, text, gen] {
+        QSaveFile snap{snapPath};
+        if (!snap.open(QFile::WriteOnly)) {
+            return;
+        }
+
+        QDataStream out{&snap};
+        out.setVersion(QDataStream::Qt_6_0);
+        out << gen << text;
+        if (snap.commit()) {
+            writeFile(journalPath, head, false);
+        }
+    });
+}
+
+void Journal::discard() {
+    discarded = true;
+    buffer.clear();
+    disconnect(doc, nullptr, this, nullptr);
+    flushTimer.stop();
+
+    const QString &journalPath = filePath("jnl");
+    const QString &snapPath = filePath("snap");
+    QMetaObject::invokeMethod(worker(), [journalPath, snapPath] {
+        QFile::remove(journalPath);
+        QFile::remove(snapPath);
+    });
+}
+
+void Journal::pause() {
+    flush();
+    disconnect(doc, nullptr, this, nullptr);
+}
+
+void Journal::resume() {
+    connect(doc, &QTextDocument::contentsChange, this, &Journal::record);
+    revision = doc->revision();
+    // The edits made while paused are only covered by a snapshot
+    compact();
+}
+
+QList<Journal::Entry> Journal::recover() {
+    QList<Entry> entries;
+
+    const QDir dir{FileUtil::dataDir("journal")};
+    const auto names = dir.entryList({"*.jnl"}, QDir::Files);
+    for (const auto &name : names) {
+        const QString &journalPath = dir.filePath(name);
+        const QString &snapPath = dir.filePath(QFileInfo{name}.completeBaseName() + ".snap");
+
+        QFile file{journalPath};
+        if (!file.open(QFile::ReadOnly)) {
+            continue;
+        }
+        QDataStream in{&file};
+        in.setVersion(QDataStream::Qt_6_0);
+
+        // Read the header
+        quint8 type;
+        quint32 version, gen;
+        QString path;
+        qint64 baseSize;
+        QDateTime baseModified;
+        in >> type >> version >> path >> baseSize >> baseModified >> gen;
+
+        bool valid = in.status() == QDataStream::Ok &&
+                     type == HEADER_RECORD && version == JOURNAL_VERSION;
+        bool replay = true;
+        QString text;
+
+        if (valid && gen == 0) {
+            // The edits apply to the file on disk, which must be unchanged
+            if (!path.isEmpty()) {
+                const QFileInfo info{path};
+                valid = info.exists() && info.size() == baseSize &&
+                        info.lastModified() == baseModified;
+                text = valid ? FileUtil::readAll(path) : "";
+            }
+        } else if (valid) {
+            // The edits apply to the snapshot of the same generation
+            QFile snap{snapPath};
+            quint32 snapGen = 0;
+            if (snap.open(QFile::ReadOnly)) {
+                QDataStream snapIn{&snap};
+                snapIn.setVersion(QDataStream::Qt_6_0);
+                snapIn >> snapGen >> text;
+                valid = snapIn.status() == QDataStream::Ok && snapGen >= gen;
+            } else {
+                valid = false;
+            }
+            // A newer snapshot already includes every edit in the journal
+            replay = snapGen == gen;
+        }
+
+        // Replay the edits, stopping at a record cut off by the crash
+        int edits = 0;
+        while (valid && replay && !in.atEnd()) {
+            qint32 pos, removed;
+            QString added;
+            in >> type >> pos >> removed >> added;
+            if (in.status() != QDataStream::Ok || type != EDIT_RECORD ||
+                pos < 0 || pos > text.size() || removed < 0) {
+                break;
+            }
+            text.replace(pos, removed, added);
+            ++edits;
+        }
+        file.close();
+
+        // Only documents that differ from the disk need to be recovered
+        if (valid && (edits > 0 || gen > 0)) {
+            entries.append({path, text});
+        }
+
+        QFile::remove(journalPath);
+        QFile::remove(snapPath);
+    }
+
+    return entries;
+}
+
+void Journal::record(int pos, int removed, int added) {
+    // Format-only changes, such as search highlights, do not alter the text
+    if (removed == added && doc->revision() == revision) {
+        return;
+    }
+    revision = doc->revision();
+
+    // Record the edit as it applies to the file, without the breaks
+    // between display segments, so it can be replayed onto the file text
+    const QString &text = Editor::fileText(doc, pos, pos + added);
+    if (Editor::hasSegments(doc)) {
+        const auto index = SegmentIndex::of(doc);
+        removed -= index->removedBreaks();
+        pos = index->filePosition(pos);
+    }
+
+    const qsizetype oldSize = buffer.size();
+    QDataStream out{&buffer, QIODevice::Append};
+    out.setVersion(QDataStream::Qt_6_0);
+    out << EDIT_RECORD << qint32(pos) << qint32(removed) << text;
+    journalSize += buffer.size() - oldSize;
+
+    // Write at most once per interval, however fast the user types
+    if (!flushTimer.isActive()) {
+        flushTimer.start();
+    }
+}
+
+void Journal::flush() {
+    flushTimer.stop();
+    if (buffer.isEmpty()) {
+        return;
+    }
+
+    const QString &journalPath = filePath("jnl");
+    const QByteArray bytes{std::exchange(buffer, {})};
+    QMetaObject::invokeMethod(worker(), [journalPath, bytes] {
+        writeFile(journalPath, bytes, true);
+    });
+
+    // Keep replay on the next launch fast
+    if (journalSize > COMPACT_SIZE) {
+        compact();
+    }
+}
+
+QByteArray Journal::header() const {
+    const QFileInfo info{path};
+
+    QByteArray bytes;
+    QDataStream out{&bytes, QIODevice::WriteOnly};
+    out.setVersion(QDataStream::Qt_6_0);
+    out << HEADER_RECORD << JOURNAL_VERSION << path
+        << (path.isEmpty() ? qint64(0) : info.size())
+        << (path.isEmpty() ? QDateTime{} : info.lastModified())
+        << generation;
+    return bytes;
+}
+
+QString Journal::filePath(const QString &ext) const {
+    return prefix + "." + ext;
+}
+
+QObject *Journal::worker() {
+    static QObject *worker = nullptr;
+    if (worker) {
+        return worker;
+    }
+
+    auto thread = new QThread;
+    worker = new QObject;
+    worker->moveToThread(thread);
+    thread->start(QThread::LowPriority);
+
+    // Finish the pending writes before the program exits
+    QObject::connect(qApp, &QApplication::aboutToQuit, qApp, [thread] {
+        QMetaObject::invokeMethod(worker, [thread] {
+            thread->quit();
+        });
+        thread->wait();
+    });
+
+    return worker;
+}
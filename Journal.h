@@ -0,0 +1,115 @@
+#pragma once
+
+#include <QObject>
+#include <QTextDocument>
+#include <QTimer>
+
+/**
+ * @brief Records the edits of a document to disk in the background,
+ * so that unsaved changes survive a crash.
+ * @note Edits are buffered in memory and flushed on a worker thread at a
+ * bounded interval. When the journal grows too large, it is compacted
+ * into a snapshot of the whole document.
+ */
+class Journal : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Contains an unsaved document recovered from a previous session.
+     */
+    struct Entry {
+        /// The file path, or an empty string for an untitled document.
+        QString path;
+        /// The recovered document text.
+        QString text;
+    };
+
+    /**
+     * @brief Initializes a new 'Journal' instance.
+     * @param doc The document to record.
+     * @param parent The parent object.
+     */
+    Journal(QTextDocument *doc, QObject *parent);
+    ~Journal();
+
+    /**
+     * @brief Starts a new journal after the document is loaded or saved.
+     * @note Recording resumes if the journal was paused.
+     * @param path The file path that the document matches on disk,
+     * or an empty string for an untitled document.
+     */
+    void reset(const QString &path);
+
+    /**
+     * @brief Replaces the journal with a snapshot of the whole document.
+     */
+    void compact();
+
+    /**
+     * @brief Deletes the journal, as the document no longer needs recovery.
+     */
+    void discard();
+
+    /**
+     * @brief Stops recording edits, such as while a large stream is loaded.
+     */
+    void pause();
+
+    /**
+     * @brief Resumes recording, starting from a snapshot of the document.
+     */
+    void resume();
+
+    /**
+     * @brief Restores the documents left unsaved by a previous session.
+     * @note Recovered journals are deleted from disk.
+     * @return The recovered documents.
+     */
+    static QList<Entry> recover();
+
+private:
+    QTextDocument *doc;
+    QString prefix;         // Path of the journal files without extension
+    QString path;           // File path of the recorded document
+
+    QByteArray buffer;      // Edits not yet written to disk
+    QTimer flushTimer;      // Flushes the buffer at a bounded interval
+    qint64 journalSize;     // Bytes recorded since the last snapshot
+    quint32 generation;     // Number of snapshots taken since the last reset
+    int revision;           // Document revision of the last recorded edit
+    bool discarded;         // Whether the journal has been deleted
+
+    /**
+     * @brief Records a change of the document.
+     * @param pos The position of the change.
+     * @param removed The number of removed characters.
+     * @param added The number of added characters.
+     */
+    void record(int pos, int removed, int added);
+
+    /**
+     * @brief Hands the buffered edits over to the worker thread.
+     */
+    void flush();
+
+    /**
+     * @brief Builds the record that starts every journal file.
+     * @return The header record.
+     */
+    QByteArray header() const;
+
+    /**
+     * @brief Provides the path of a journal file.
+     * @param ext The file extension.
+     * @return The full path of the file.
+     */
+    QString filePath(const QString &ext) const;
+
+    /**
+     * @brief Provides an object living in the worker thread,
+     * which performs all file operations in order.
+     * @return The worker object.
+     */
+    static QObject *worker();
+};
@@ -0,0 +1,1115 @@
+#include "LargeWindow.h"
+#include "AppInfo.h"
+#include "MainWindow.h"
+#include "MenuBar.h"
+#include "StatusBar.h"
+#include "Editor.h"
+#include "RecentFiles.h"
+#include "Attr.h"
+
+#include <QApplication>
+#include <QClipboard>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QDir>
+#include <QScrollBar>
+#include <QPainter>
+#include <QKeyEvent>
+#include <QInputMethodEvent>
+#include <QMouseEvent>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <QShortcut>
+#include <QTextLayout>
+#include <QFontInfo>
+#include <QtMath>
+
+#include <algorithm>
+#include <limits>
+
+QList<LargeWindow *> LargeWindow::windows;
+QHash<FileId, LargeWindow *> LargeWindow::idIndex;
+QHash<QString, LargeWindow *> LargeWindow::pathIndex;
+
+LargeWindow::LargeWindow(const QString &path, const std::shared_ptr<PieceTable> &table)
+    : filePath{path}, fileName{QFileInfo{path}.fileName()} {
+    // Register this instance
+    windows.append(this);
+    registerFile();
+
+    resize(1080, 720);
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    // Place the view in the center
+    view = new LargeView{table, this};
+    connect(view, &LargeView::positionChanged, this, &LargeWindow::updatePos);
+    connect(view, &LargeView::modificationChanged, this, &LargeWindow::updateTitle);
+    // Wait for the event that noticed the truncation to finish
+    connect(view, &LargeView::fileLost, this, &LargeWindow::reopen, Qt::QueuedConnection);
+    setCentralWidget(view);
+
+    // Share the menus of the text windows, whose actions apply to this
+    // window while it is active
+    setMenuBar(new MenuBar{this});
+
+    // Place a status bar on the bottom, as in the text windows
+    statusBar = new StatusBar{this};
+    statusBar->setVisible(Attr::get().showStatus);
+    setStatusBar(statusBar);
+    updatePos();
+    updateTitle();
+
+    show();
+    raise();
+    activateWindow();
+    view->setFocus();
+
+    // Use <Cmd+W> to close window in macOS
+    auto *closeShortcut = new QShortcut{QKeySequence::Close, this};
+    connect(closeShortcut, &QShortcut::activated, this, &LargeWindow::close);
+}
+
+void LargeWindow::open(const QString &path, const std::shared_ptr<PieceTable> &table,
+                       int line, int column) {
+    // If a file is already opened in another window, switch to that window
+    if (auto win = findWindow(path)) {
+        win->jumpTo(line, column);
+        return;
+    }
+
+    // Without the file content, saving would replace the file with
+    // whatever was typed into the empty view
+    auto win = new LargeWindow(path, table);
+    if (!win->view->isValid()) {
+        QMessageBox::critical(win, AppInfo::name(),
+                              tr("Unable to open %0!").arg(path));
+        win->close();
+        return;
+    }
+    win->jumpTo(line, column);
+}
+
+LargeWindow *LargeWindow::findWindow(const QString &path) {
+    // Links and renamed parent directories lead to the same identity
+    const FileId &id = FileUtil::fileId(path);
+    if (id.isValid()) {
+        if (auto win = idIndex.value(id)) {
+            return win;
+        }
+    }
+    return pathIndex.value(FileUtil::canonicalPath(path));
+}
+
+void LargeWindow::jumpTo(int line, int column) {
+    show();
+    raise();
+    activateWindow();
+    if (line > 0) {
+        view->goTo(line - 1, qMax(0, column - 1));
+    }
+}
+
+LargeView *LargeWindow::getView() const {
+    return view;
+}
+
+void LargeWindow::applySettings() {
+    for (auto win : std::as_const(windows)) {
+        win->view->updateSettings();
+        win->statusBar->updateZoom();
+        win->statusBar->setVisible(Attr::get().showStatus);
+    }
+}
+
+void LargeWindow::closeEvent(QCloseEvent *event) {
+    if (view->isModified()) {
+        // If the file is unsaved, prompt the user to save it
+        const auto &ans = QMessageBox::question(
+            this, tr("Confirm Exiting"),
+            tr("Do you want to save changes to %0?").arg(fileName),
+            QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+
+        // If the saving is interrupted, or if the user selects 'Cancel',
+        // this window will not be closed
+        if (!((ans == QMessageBox::Yes && save()) || ans == QMessageBox::No)) {
+            event->ignore();
+            return;
+        }
+    }
+
+    windows.removeOne(this);
+    unregisterFile();
+    QMainWindow::closeEvent(event);
+}
+
+bool LargeWindow::save() {
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool ok = view->save(filePath);
+    QApplication::restoreOverrideCursor();
+
+    if (!ok) {
+        QMessageBox::critical(this, AppInfo::name(),
+                              tr("Unable to save %0!").arg(fileName));
+        return false;
+    }
+
+    // Saving replaced the file with a new inode
+    registerFile();
+    return true;
+}
+
+void LargeWindow::saveAs() {
+    // Prompt the user to select where to save the file
+    const QString &path = QFileDialog::getSaveFileName(
+        this, QFileDialog::tr("Save As"), Attr::get().recentDir);
+
+    // Exit the function if the user closes the file dialog
+    if (path.isEmpty()) {
+        return;
+    }
+
+    // Get the full file path
+    const QString &fullPath = QFileInfo{path}.absoluteFilePath();
+
+    // Update the recent directory
+    Attr::get().recentDir = QFileInfo{path}.absolutePath();
+    Attr::get().changed();
+
+    // If the selected path is the same as the original path,
+    // save the current file
+    auto opened = findWindow(fullPath);
+    if (opened == this) {
+        save();
+        return;
+    }
+
+    // If a file is already opened in another window, close that window
+    if (opened) {
+        opened->close();
+    }
+    if (auto textWin = MainWindow::findWindow(fullPath)) {
+        textWin->close();
+    }
+
+    const QString oldPath = filePath;
+    filePath = fullPath;
+    fileName = QFileInfo{fullPath}.fileName();
+    if (!save()) {
+        // Keep editing the original file
+        filePath = oldPath;
+        fileName = QFileInfo{oldPath}.fileName();
+        return;
+    }
+    RecentFiles::add(filePath);
+    updateTitle();
+}
+
+void LargeWindow::goTo() {
+    bool ok;
+    const qint64 lineCount = view->lineCount();
+    const QString text = QInputDialog::getText(
+        this, tr("Go To"), tr("Line Number (1 - %0):").arg(lineCount),
+        QLineEdit::Normal, QString::number(view->cursorLine() + 1), &ok).trimmed();
+
+    // Exit the function if the user closes the dialog
+    if (!ok || text.isEmpty()) {
+        return;
+    }
+
+    const qint64 line = text.toLongLong(&ok);
+    if (!ok || line < 1 || line > lineCount) {
+        QMessageBox::critical(this, AppInfo::name(), tr("Invalid line number!"));
+        return;
+    }
+
+    view->goTo(line - 1);
+}
+
+void LargeWindow::updateTitle() {
+    // Unsaved file starts with an asterisk symbol (*)
+    setWindowTitle((view->isModified() ? "*" : "") + fileName + " - " + AppInfo::name());
+}
+
+void LargeWindow::updatePos() {
+    statusBar->showCursorPos(view->cursorLine() + 1, view->cursorColumn() + 1);
+    statusBar->showMemory(view->memoryUsage());
+}
+
+void LargeWindow::reopen() {
+    QMessageBox::warning(this, AppInfo::name(),
+                         tr("%0 was truncated by another program, so it is opened again "
+                            "without the unsaved changes.").arg(fileName));
+
+    // Leave the index first, so that the file opens in a new window
+    unregisterFile();
+    MainWindow::openAll({{filePath}}, QDir::currentPath(), true);
+    close();
+}
+
+void LargeWindow::registerFile() {
+    unregisterFile();
+    fileId = FileUtil::fileId(filePath);
+    canonicalPath = FileUtil::canonicalPath(filePath);
+    if (fileId.isValid()) {
+        idIndex.insert(fileId, this);
+    }
+    pathIndex.insert(canonicalPath, this);
+}
+
+void LargeWindow::unregisterFile() {
+    // Only remove the entries that still point to this window
+    if (fileId.isValid() && idIndex.value(fileId) == this) {
+        idIndex.remove(fileId);
+    }
+    if (!canonicalPath.isEmpty() && pathIndex.value(canonicalPath) == this) {
+        pathIndex.remove(canonicalPath);
+    }
+    fileId = {};
+    canonicalPath.clear();
+}
+
+LargeView::LargeView(const std::shared_ptr<PieceTable> &opened, QWidget *parent)
+    : QAbstractScrollArea{parent}, table{opened}, cursor{0}, anchor{0}, targetX{0},
+      linesPerStep{1}, textWidth{0}, newline{"\n"}, advance{0}, ascent{0}, monospace{false},
+      columnLine{-1} {
+    // Keep an empty table if the file could not be mapped
+    valid = opened != nullptr;
+    if (!valid) {
+        table = std::make_shared<PieceTable>();
+    }
+    savedSnapshot = table->snapshot();
+
+    // Keep the line breaks of the file when inserting new lines
+    const qint64 firstEnd = table->lineEnd(0);
+    if (firstEnd > 0 && table->read(firstEnd - 1, 1) == "\r") {
+        newline = "\r\n";
+    }
+
+    // Match the look of the editor
+    auto newPalette{palette()};
+    newPalette.setColor(QPalette::Inactive, QPalette::Highlight,
+                        newPalette.color(QPalette::Active, QPalette::Highlight));
+    newPalette.setColor(QPalette::Inactive, QPalette::HighlightedText,
+                        newPalette.color(QPalette::Active, QPalette::HighlightedText));
+    setPalette(newPalette);
+    viewport()->setCursor(Qt::IBeamCursor);
+    setFocusPolicy(Qt::StrongFocus);
+    setAttribute(Qt::WA_InputMethodEnabled);
+    updateFont();
+
+    // Line numbers are painted beside the viewport, as in the editor
+    lineBar = new QWidget{this};
+    lineBar->installEventFilter(this);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged,
+            lineBar, qOverload<>(&QWidget::update));
+
+    updateScrollBars();
+}
+
+bool LargeView::isValid() const {
+    return valid;
+}
+
+bool LargeView::isModified() const {
+    return table->snapshot() != savedSnapshot;
+}
+
+bool LargeView::save(const QString &path) {
+    // Never write over the file without its original content
+    if (!checkFile() || !valid) {
+        return false;
+    }
+    if (!table->save(path)) {
+        // The table may have lost the file while replacing it
+        checkFile();
+        return false;
+    }
+
+    // The steps point into the replaced file
+    undoSteps.clear();
+    redoSteps.clear();
+    fastSpans.clear();
+    savedSnapshot = table->snapshot();
+    emit modificationChanged();
+    return true;
+}
+
+qint64 LargeView::memoryUsage() const {
+    return table->memoryUsage();
+}
+
+qint64 LargeView::lineCount() const {
+    return table->lineCount();
+}
+
+qint64 LargeView::cursorLine() const {
+    return table->lineAt(cursor);
+}
+
+int LargeView::cursorColumn() const {
+    return indexAt(cursor);
+}
+
+void LargeView::goTo(qint64 line, int column) {
+    checkFile();
+    line = qBound<qint64>(0, line, lineCount() - 1);
+    moveCursor(column > 0 ? offsetAt(line, column) : table->lineStart(line));
+
+    // Show the line on the top third of the viewport
+    const qint64 top = qMax<qint64>(0, line - visibleLines() / 3);
+    verticalScrollBar()->setValue(static_cast<int>(top / linesPerStep));
+}
+
+bool LargeView::hasSelection() const {
+    return cursor != anchor;
+}
+
+bool LargeView::canUndo() const {
+    return !undoSteps.isEmpty();
+}
+
+bool LargeView::canRedo() const {
+    return !redoSteps.isEmpty();
+}
+
+void LargeView::undo() {
+    checkFile();
+    restoreStep(undoSteps, redoSteps);
+}
+
+void LargeView::redo() {
+    checkFile();
+    restoreStep(redoSteps, undoSteps);
+}
+
+void LargeView::cut() {
+    copy();
+    replaceSelection({});
+}
+
+void LargeView::copy() {
+    checkFile();
+    if (cursor != anchor) {
+        const qint64 start = qMin(cursor, anchor);
+        const QByteArray &bytes = table->read(start, qAbs(cursor - anchor));
+        QApplication::clipboard()->setText(QString::fromUtf8(bytes));
+    }
+}
+
+void LargeView::paste() {
+    checkFile();
+    QString text = QApplication::clipboard()->text();
+    text.replace("\r\n", "\n");
+    replaceSelection(text.toUtf8().replace("\n", newline));
+}
+
+void LargeView::removeSelection() {
+    checkFile();
+    replaceSelection({});
+}
+
+void LargeView::selectAll() {
+    checkFile();
+    anchor = 0;
+    moveCursor(table->size(), true);
+}
+
+void LargeView::updateSettings() {
+    checkFile();
+    // Lines are measured again in the new font as they are painted
+    updateFont();
+    textWidth = 0;
+    updateScrollBars();
+    moveCursor(cursor, true);
+}
+
+void LargeView::updateFont() {
+    QFont font{Attr::get().editorFont};
+    const int size = font.pointSize() * Attr::get().zoom / 100.0;
+    if (size > 0) {
+        font.setPointSize(size);
+    }
+    if (QFontInfo{font}.fixedPitch()) {
+        font.setStyleStrategy(QFont::StyleStrategy(font.styleStrategy() | QFont::PreferNoShaping));
+    }
+    setFont(font);
+    updateFastPath();
+}
+
+bool LargeView::checkFile() {
+    if (!valid || table->isIntact()) {
+        return true;
+    }
+
+    // The pages past the new end of the file can no longer be read,
+    // so drop the text instead of reading them
+    valid = false;
+    table = std::make_shared<PieceTable>();
+    savedSnapshot = table->snapshot();
+    undoSteps.clear();
+    redoSteps.clear();
+    fastSpans.clear();
+    columnLine = -1;
+    cursor = 0;
+    anchor = 0;
+    textWidth = 0;
+    updateScrollBars();
+
+    emit modificationChanged();
+    emit positionChanged();
+    emit fileLost();
+    return false;
+}
+
+bool LargeView::event(QEvent *event) {
+    // Keys and input methods read the text
+    checkFile();
+
+    // Keep the keys that edit text from the shortcuts of the shared menus
+    if (event->type() == QEvent::ShortcutOverride) {
+        const auto keyEvent = static_cast<QKeyEvent *>(event);
+        if ((keyEvent->key() == Qt::Key_Delete || keyEvent->key() == Qt::Key_Backspace)
+            && !(keyEvent->modifiers() & ~(Qt::ShiftModifier | Qt::KeypadModifier))) {
+            event->accept();
+            return true;
+        }
+    }
+    return QAbstractScrollArea::event(event);
+}
+
+bool LargeView::viewportEvent(QEvent *event) {
+    // Painting and the mouse read the text on the viewport
+    checkFile();
+    return QAbstractScrollArea::viewportEvent(event);
+}
+
+void LargeView::paintEvent(QPaintEvent *) {
+    QPainter painter{viewport()};
+    const int lineHeight = fontMetrics().height();
+    const qint64 first = topLine();
+    const qint64 last = qMin(lineCount(), first + visibleLines() + 1);
+    const int xOffset = -horizontalScrollBar()->value();
+    const qint64 selStart = qMin(cursor, anchor);
+    const qint64 selEnd = qMax(cursor, anchor);
+    const qint64 caretLine = hasFocus() ? table->lineAt(cursor) : -1;
+    const qreal right = horizontalScrollBar()->value() + viewport()->width();
+    qreal widest = textWidth;
+
+    // Only the lines on screen, and the spans of long lines on screen,
+    // are laid out
+    for (qint64 line = first; line < last; ++line) {
+        const qreal y = static_cast<qreal>((line - first) * lineHeight);
+        const qint64 end = contentEnd(line);
+        const qint64 caretSpan = caretLine == line ? spanAt(line, cursor).start : -1;
+
+        Span span = spanAtX(line, horizontalScrollBar()->value());
+        const bool cut = span.start > table->lineStart(line) || span.end < end;
+        for (;;) {
+            const QPointF pos{xOffset + span.x, y};
+            const Span next = span.end < end ? spanAt(line, span.end) : span;
+
+            // Spans of a long line are kept to their place
+            if (cut) {
+                const qreal nextX = next.start > span.start ? next.x : right;
+                painter.save();
+                painter.setClipRect(QRectF{pos.x(), y, nextX - span.x, static_cast<qreal>(lineHeight)});
+            }
+
+            // Plain ASCII spans are drawn from their cached glyphs
+            const FastSpan &fast = fastSpan(span);
+            if (fast.valid) {
+                painter.setPen(palette().color(QPalette::Text));
+                painter.drawGlyphRun(pos, fast.run);
+
+                // Selected glyphs are drawn again over the highlight
+                if (selStart < span.end && selEnd > span.start) {
+                    const qreal left = fast.xs[qMax(selStart, span.start) - span.start];
+                    const qreal selRight = fast.xs[qMin(selEnd, span.end) - span.start];
+                    const QRectF rect{pos.x() + left, y, selRight - left,
+                                      static_cast<qreal>(lineHeight)};
+                    painter.fillRect(rect, palette().highlight());
+                    painter.save();
+                    painter.setClipRect(rect, Qt::IntersectClip);
+                    painter.setPen(palette().color(QPalette::HighlightedText));
+                    painter.drawGlyphRun(pos, fast.run);
+                    painter.restore();
+                }
+
+                if (caretSpan == span.start) {
+                    painter.fillRect(QRectF{pos.x() + fast.xs[qMin(cursor, span.end) - span.start], y,
+                                            1, static_cast<qreal>(lineHeight)},
+                                     palette().text());
+                }
+                widest = qMax(widest, span.x + fast.xs.last());
+            } else {
+                QTextLayout layout;
+                layoutSpan(layout, span);
+                QList<QTextLayout::FormatRange> selections;
+                if (selStart < span.end && selEnd > span.start) {
+                    QTextLayout::FormatRange range;
+                    range.start = spanIndex(span, qMax(selStart, span.start));
+                    range.length = (selEnd > span.end ? layout.text().size()
+                                                      : spanIndex(span, selEnd)) - range.start;
+                    range.format.setBackground(palette().highlight());
+                    range.format.setForeground(palette().highlightedText());
+                    selections.append(range);
+                }
+
+                layout.draw(&painter, pos, selections);
+                if (caretSpan == span.start) {
+                    layout.drawCursor(&painter, pos, spanIndex(span, cursor));
+                }
+                widest = qMax(widest, span.x + layout.lineAt(0).naturalTextWidth());
+            }
+            if (cut) {
+                painter.restore();
+            }
+
+            if (next.start == span.start || next.x >= right) {
+                break;
+            }
+            span = next;
+        }
+
+        // The spans after the viewport still widen the scroll range
+        if (cut) {
+            widest = qMax(widest, (end - table->lineStart(line)) * charWidth());
+        }
+    }
+
+    // Lines only widen the horizontal scroll range as they are seen
+    widest = qMin<qreal>(widest, std::numeric_limits<int>::max() / 2);
+    if (widest > textWidth) {
+        textWidth = qCeil(widest);
+        updateScrollBars();
+    }
+}
+
+void LargeView::resizeEvent(QResizeEvent *event) {
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void LargeView::keyPressEvent(QKeyEvent *event) {
+    const bool shift = event->modifiers() & Qt::ShiftModifier;
+    const bool ctrl = event->modifiers() & Qt::ControlModifier;
+    const qint64 line = table->lineAt(cursor);
+
+    switch (event->key()) {
+    case Qt::Key_Left:
+    case Qt::Key_Right: {
+        const bool left = event->key() == Qt::Key_Left;
+
+        // Without shift, a selection collapses to its edge
+        if (!shift && cursor != anchor) {
+            moveCursor(left ? qMin(cursor, anchor) : qMax(cursor, anchor));
+        } else if (left && cursor == table->lineStart(line)) {
+            moveCursor(line > 0 ? contentEnd(line - 1) : 0, shift);
+        } else if (!left && cursor == contentEnd(line)) {
+            moveCursor(table->lineStart(line + 1), shift);
+        } else {
+            const Span &span = stepSpan(line, left);
+            QTextLayout layout;
+            layoutSpan(layout, span);
+            const auto mode = ctrl ? QTextLayout::SkipWords : QTextLayout::SkipCharacters;
+            const int index = left ? layout.previousCursorPosition(spanIndex(span, cursor), mode)
+                                   : layout.nextCursorPosition(spanIndex(span, cursor), mode);
+            moveCursor(spanOffset(span, index), shift);
+        }
+        return;
+    }
+    case Qt::Key_Up:
+        moveLines(-1, shift);
+        return;
+    case Qt::Key_Down:
+        moveLines(1, shift);
+        return;
+    case Qt::Key_PageUp:
+        moveLines(-visibleLines(), shift);
+        return;
+    case Qt::Key_PageDown:
+        moveLines(visibleLines(), shift);
+        return;
+    case Qt::Key_Home:
+        moveCursor(ctrl ? 0 : table->lineStart(line), shift);
+        return;
+    case Qt::Key_End:
+        moveCursor(ctrl ? table->size() : contentEnd(line), shift);
+        return;
+    case Qt::Key_Backspace:
+        if (cursor != anchor) {
+            replaceSelection({});
+        } else if (cursor == table->lineStart(line) && line > 0) {
+            removeRange(contentEnd(line - 1), cursor);
+        } else if (cursor > 0) {
+            const Span &span = stepSpan(line, true);
+            QTextLayout layout;
+            layoutSpan(layout, span);
+            const int index = spanIndex(span, cursor);
+            removeRange(spanOffset(span, layout.previousCursorPosition(index)), cursor);
+        }
+        return;
+    case Qt::Key_Delete:
+        if (cursor != anchor) {
+            replaceSelection({});
+        } else if (cursor == contentEnd(line)) {
+            removeRange(cursor, table->lineStart(line + 1));
+        } else {
+            const Span &span = stepSpan(line, false);
+            QTextLayout layout;
+            layoutSpan(layout, span);
+            const int index = spanIndex(span, cursor);
+            removeRange(cursor, spanOffset(span, layout.nextCursorPosition(index)));
+        }
+        return;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        replaceSelection(newline);
+        return;
+    default:
+        break;
+    }
+
+    // Insert typed characters, including tabs
+    const QString &text = event->text();
+    if (!ctrl && !text.isEmpty() && (text[0].isPrint() || text[0] == '\t')) {
+        replaceSelection(text.toUtf8());
+        return;
+    }
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void LargeView::inputMethodEvent(QInputMethodEvent *event) {
+    // Only committed text is inserted; the preedit text is left to the
+    // input method's own window
+    if (!event->commitString().isEmpty()) {
+        replaceSelection(event->commitString().toUtf8());
+    }
+    event->accept();
+}
+
+QVariant LargeView::inputMethodQuery(Qt::InputMethodQuery query) const {
+    switch (query) {
+    case Qt::ImCursorRectangle: {
+        // Place the input method's window under the cursor
+        const int lineHeight = fontMetrics().height();
+        const qint64 line = table->lineAt(cursor);
+        const int x = static_cast<int>(qMin<qreal>(cursorX(line, cursor),
+                                                   std::numeric_limits<int>::max() / 2));
+        const QRect rect{x - horizontalScrollBar()->value(),
+                         static_cast<int>(line - topLine()) * lineHeight, 1, lineHeight};
+        return rect.translated(viewport()->pos());
+    }
+    case Qt::ImEnabled:
+        return true;
+    default:
+        return QAbstractScrollArea::inputMethodQuery(query);
+    }
+}
+
+void LargeView::mousePressEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton) {
+        moveCursor(offsetAt(event->position().toPoint()),
+                   event->modifiers() & Qt::ShiftModifier);
+    }
+}
+
+void LargeView::mouseMoveEvent(QMouseEvent *event) {
+    // Dragging extends the selection
+    if (event->buttons() & Qt::LeftButton) {
+        moveCursor(offsetAt(event->position().toPoint()), true);
+    }
+}
+
+void LargeView::focusInEvent(QFocusEvent *event) {
+    QAbstractScrollArea::focusInEvent(event);
+    viewport()->update();
+}
+
+void LargeView::focusOutEvent(QFocusEvent *event) {
+    QAbstractScrollArea::focusOutEvent(event);
+    viewport()->update();
+}
+
+bool LargeView::eventFilter(QObject *watched, QEvent *event) {
+    if (watched == lineBar && event->type() == QEvent::Paint) {
+        paintLineBar();
+        return true;
+    }
+    return QAbstractScrollArea::eventFilter(watched, event);
+}
+
+qint64 LargeView::topLine() const {
+    return static_cast<qint64>(verticalScrollBar()->value()) * linesPerStep;
+}
+
+int LargeView::visibleLines() const {
+    return qMax(1, viewport()->height() / fontMetrics().height());
+}
+
+qint64 LargeView::contentEnd(qint64 line) const {
+    const qint64 end = table->lineEnd(line);
+    const qint64 start = table->lineStart(line);
+
+    // A carriage return before the line break is not part of the line
+    if (end > start && end < table->size() && table->read(end - 1, 1) == "\r") {
+        return end - 1;
+    }
+    return end;
+}
+
+LargeView::Span LargeView::spanAt(qint64 line, qint64 offset) const {
+    const qint64 start = table->lineStart(line);
+    const qint64 end = contentEnd(line);
+    if (end - start <= LINE_SPAN) {
+        return {start, end, 0};
+    }
+
+    // Cut every 'LINE_SPAN' bytes, moved forward past the continuation
+    // bytes of a character
+    const auto cutAt = [this, start, end] (qint64 number) {
+        const qint64 at = start + number * LINE_SPAN;
+        if (number <= 0 || at >= end) {
+            return qMin(at, end);
+        }
+        const QByteArray &bytes = table->read(at, qMin<qint64>(4, end - at));
+        int skip = 0;
+        while (skip < bytes.size() - 1 && (bytes[skip] & 0xC0) == 0x80) {
+            ++skip;
+        }
+        return at + skip;
+    };
+    const qint64 number = qBound<qint64>(0, (offset - start) / LINE_SPAN, (end - start - 1) / LINE_SPAN);
+    const qint64 from = cutAt(number);
+    return {from, cutAt(number + 1), (from - start) * charWidth()};
+}
+
+LargeView::Span LargeView::spanAtX(qint64 line, qreal x) const {
+    const qint64 number = static_cast<qint64>(qMax<qreal>(0, x / (LINE_SPAN * charWidth())));
+    return spanAt(line, table->lineStart(line) + number * LINE_SPAN);
+}
+
+LargeView::Span LargeView::stepSpan(qint64 line, bool backward) const {
+    const Span &span = spanAt(line, cursor);
+    return backward && cursor == span.start ? spanAt(line, cursor - LINE_SPAN) : span;
+}
+
+qreal LargeView::charWidth() const {
+    return monospace ? advance : qMax(1, fontMetrics().averageCharWidth());
+}
+
+void LargeView::layoutSpan(QTextLayout &layout, const Span &span) const {
+    const QString &text = QString::fromUtf8(table->read(span.start, span.end - span.start));
+    layout.setText(text);
+
+    // Skip shaping like the editor, so shaped spans draw the same glyphs
+    // as the fast ones, without ligatures
+    QFont spanFont{font()};
+    if (Editor::needsShaping(text)) {
+        spanFont.setStyleStrategy(
+            QFont::StyleStrategy(spanFont.styleStrategy() & ~QFont::PreferNoShaping));
+    }
+    layout.setFont(spanFont);
+
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    layout.setTextOption(option);
+
+    layout.beginLayout();
+    QTextLine textLine = layout.createLine();
+    textLine.setLineWidth(viewport()->width());
+    layout.endLayout();
+}
+
+qint64 LargeView::spanOffset(const Span &span, int index) const {
+    const QString &text = QString::fromUtf8(table->read(span.start, span.end - span.start));
+    return span.start + text.left(index).toUtf8().size();
+}
+
+int LargeView::spanIndex(const Span &span, qint64 offset) const {
+    return static_cast<int>(QString::fromUtf8(table->read(span.start, offset - span.start)).size());
+}
+
+int LargeView::spanLength(const Span &span) const {
+    // Plain ASCII has a character per byte, so it needs no decoding
+    const QByteArray &bytes = table->read(span.start, span.end - span.start);
+    if (std::all_of(bytes.cbegin(), bytes.cend(), [] (char c) { return (c & 0x80) == 0; })) {
+        return static_cast<int>(bytes.size());
+    }
+    return static_cast<int>(QString::fromUtf8(bytes).size());
+}
+
+int LargeView::charsBefore(qint64 line, qint64 number) const {
+    if (line != columnLine) {
+        columnLine = line;
+        columnStarts = {0};
+    }
+
+    // Count the spans up to the one asked for, once per line until an edit
+    const qint64 start = table->lineStart(line);
+    while (columnStarts.size() <= number) {
+        const Span &span = spanAt(line, start + (columnStarts.size() - 1) * LINE_SPAN);
+        columnStarts.append(columnStarts.last() + spanLength(span));
+    }
+    return columnStarts[number];
+}
+
+qint64 LargeView::offsetAt(qint64 line, int index) const {
+    // Find the span from the characters before each, so a long line is
+    // never decoded at once
+    const qint64 start = table->lineStart(line);
+    const qint64 last = qMax<qint64>(0, contentEnd(line) - start - 1) / LINE_SPAN;
+    qint64 number = 0;
+    while (number < last && charsBefore(line, number + 1) <= index) {
+        number++;
+    }
+    const Span &span = spanAt(line, start + number * LINE_SPAN);
+    return spanOffset(span, index - charsBefore(line, number));
+}
+
+int LargeView::indexAt(qint64 offset) const {
+    const qint64 line = table->lineAt(offset);
+    const Span &span = spanAt(line, offset);
+    const qint64 number = (span.start - table->lineStart(line)) / LINE_SPAN;
+    return charsBefore(line, number) + spanIndex(span, offset);
+}
+
+void LargeView::updateFastPath() {
+    fastSpans.clear();
+    rawFont = QRawFont::fromFont(font());
+    ascent = fontMetrics().ascent();
+
+    QString ascii;
+    for (char16_t c = 0x20; c < 0x7F; ++c) {
+        ascii += QChar{c};
+    }
+    asciiGlyphs = rawFont.glyphIndexesForString(ascii);
+    const QList<QPointF> &advances = rawFont.advancesForGlyphIndexes(asciiGlyphs);
+    advance = advances.isEmpty() ? 0 : advances.first().x();
+
+    // Trust the advances rather than the font's claim to be monospace
+    monospace = QFontInfo{font()}.fixedPitch() && rawFont.isValid() && advance > 0
+                && asciiGlyphs.size() == ascii.size()
+                && std::none_of(asciiGlyphs.cbegin(), asciiGlyphs.cend(),
+                                [] (quint32 glyph) { return glyph == 0; })
+                && std::all_of(advances.cbegin(), advances.cend(), [this] (const QPointF &a) {
+                       return qAbs(a.x() - advance) < 0.01;
+                   });
+}
+
+const LargeView::FastSpan &LargeView::fastSpan(const Span &span) const {
+    const auto it = fastSpans.constFind(span.start);
+    if (it != fastSpans.cend()) {
+        return *it;
+    }
+
+    // Keep about a few screens of spans
+    if (fastSpans.size() > 4 * (visibleLines() + 1)) {
+        fastSpans.clear();
+    }
+
+    FastSpan fast{monospace, {}, {}};
+    if (monospace) {
+        const QByteArray &bytes = table->read(span.start, span.end - span.start);
+        const qreal tabStop = QTextOption{}.tabStopDistance();
+
+        QList<quint32> glyphs;
+        QList<QPointF> positions;
+        glyphs.reserve(bytes.size());
+        positions.reserve(bytes.size());
+        fast.xs.reserve(bytes.size() + 1);
+
+        // Every byte is a character, so indexes are byte offsets
+        qreal x = 0;
+        for (const char c : bytes) {
+            fast.xs.append(x);
+            if (c == '\t') {
+                x = (qFloor(x / tabStop) + 1) * tabStop;
+            } else if (c >= 0x20 && c < 0x7F) {
+                glyphs.append(asciiGlyphs[c - 0x20]);
+                positions.append(QPointF{x, ascent});
+                x += advance;
+            } else {
+                // Other characters may need shaping or fallback fonts
+                fast.valid = false;
+                break;
+            }
+        }
+        fast.xs.append(x);
+
+        if (fast.valid) {
+            fast.run.setRawFont(rawFont);
+            fast.run.setGlyphIndexes(glyphs);
+            fast.run.setPositions(positions);
+        }
+    }
+    return *fastSpans.insert(span.start, fast);
+}
+
+qreal LargeView::cursorX(qint64 line, qint64 offset) const {
+    const Span &span = spanAt(line, offset);
+    const FastSpan &fast = fastSpan(span);
+    if (fast.valid) {
+        const qint64 index = offset - span.start;
+        return span.x + fast.xs[qBound<qint64>(0, index, fast.xs.size() - 1)];
+    }
+
+    QTextLayout layout;
+    layoutSpan(layout, span);
+    return span.x + layout.lineAt(0).cursorToX(spanIndex(span, offset));
+}
+
+qint64 LargeView::offsetAtX(qint64 line, qreal x) const {
+    const Span &span = spanAtX(line, x);
+    x -= span.x;
+    const FastSpan &fast = fastSpan(span);
+    if (fast.valid) {
+        // Pick the nearer of the boundaries around the position
+        const auto next = std::lower_bound(fast.xs.cbegin(), fast.xs.cend(), x);
+        qsizetype index = next - fast.xs.cbegin();
+        if (index > 0 && (next == fast.xs.cend() || x - *(next - 1) < *next - x)) {
+            --index;
+        }
+        return span.start + index;
+    }
+
+    QTextLayout layout;
+    layoutSpan(layout, span);
+    return spanOffset(span, layout.lineAt(0).xToCursor(x));
+}
+
+qint64 LargeView::offsetAt(const QPoint &pos) const {
+    const qint64 line = qBound<qint64>(0, topLine() + pos.y() / fontMetrics().height(),
+                                       lineCount() - 1);
+    return offsetAtX(line, pos.x() + horizontalScrollBar()->value());
+}
+
+void LargeView::moveCursor(qint64 offset, bool keepAnchor, bool keepX) {
+    cursor = qBound<qint64>(0, offset, table->size());
+    if (!keepAnchor) {
+        anchor = cursor;
+    }
+
+    const qint64 line = table->lineAt(cursor);
+    const qreal x = qMin<qreal>(cursorX(line, cursor), std::numeric_limits<int>::max() / 2);
+    if (!keepX) {
+        targetX = x;
+    }
+
+    // Scroll the cursor into view if it is off screen
+    if (line < topLine()) {
+        verticalScrollBar()->setValue(static_cast<int>(line / linesPerStep));
+    } else if (line >= topLine() + visibleLines()) {
+        const qint64 top = line - visibleLines() + 1;
+        verticalScrollBar()->setValue(static_cast<int>((top + linesPerStep - 1) / linesPerStep));
+    }
+    const int left = horizontalScrollBar()->value();
+    if (x < left) {
+        horizontalScrollBar()->setValue(static_cast<int>(x));
+    } else if (x >= left + viewport()->width()) {
+        horizontalScrollBar()->setValue(static_cast<int>(x) - viewport()->width() + 1);
+    }
+
+    viewport()->update();
+    emit positionChanged();
+}
+
+void LargeView::moveLines(qint64 count, bool keepAnchor) {
+    const qint64 line = qBound<qint64>(0, table->lineAt(cursor) + count, lineCount() - 1);
+    moveCursor(offsetAtX(line, targetX), keepAnchor, true);
+}
+
+void LargeView::replaceSelection(const QByteArray &bytes) {
+    const qint64 start = qMin(cursor, anchor);
+    const qint64 end = qMax(cursor, anchor);
+    if (start == end && bytes.isEmpty()) {
+        return;
+    }
+
+    // Each step is a pointer to an earlier tree, so it costs no text
+    const bool wasModified = isModified();
+    undoSteps.append({table->snapshot(), cursor});
+    redoSteps.clear();
+
+    table->remove(start, end - start);
+    table->insert(start, bytes);
+    fastSpans.clear();
+    columnLine = -1;
+    updateScrollBars();
+    moveCursor(start + bytes.size());
+
+    if (wasModified != isModified()) {
+        emit modificationChanged();
+    }
+}
+
+void LargeView::removeRange(qint64 from, qint64 to) {
+    anchor = from;
+    cursor = to;
+    replaceSelection({});
+}
+
+void LargeView::restoreStep(QList<Step> &from, QList<Step> &to) {
+    if (from.isEmpty()) {
+        return;
+    }
+
+    const bool wasModified = isModified();
+    to.append({table->snapshot(), cursor});
+    const Step step = from.takeLast();
+    table->restore(step.snapshot);
+    fastSpans.clear();
+    columnLine = -1;
+    updateScrollBars();
+    moveCursor(step.cursor);
+
+    if (wasModified != isModified()) {
+        emit modificationChanged();
+    }
+}
+
+int LargeView::lineBarWidth() const {
+    // Hide the line bar by setting its width to 0
+    if (!Attr::get().showLine) {
+        return 0;
+    }
+
+    const int digits = QString::number(lineCount()).size() + 2;
+    return fontMetrics().averageCharWidth() * digits;
+}
+
+void LargeView::paintLineBar() {
+    QPainter painter{lineBar};
+    const int lineHeight = fontMetrics().height();
+    const qint64 first = topLine();
+    const qint64 last = qMin(lineCount(), first + visibleLines() + 1);
+
+    for (qint64 line = first; line < last; ++line) {
+        const QString &number = QString::number(line + 1) + " ";
+        painter.drawText(0, static_cast<int>(line - first) * lineHeight, lineBar->width(),
+                         lineHeight, Qt::AlignRight, number);
+    }
+}
+
+void LargeView::updateScrollBars() {
+    // Scroll bars are limited to int, so files with very many lines
+    // scroll by several lines per step
+    const qint64 lines = lineCount();
+    linesPerStep = static_cast<int>(lines / std::numeric_limits<int>::max() + 1);
+
+    const qint64 maxLine = qMax<qint64>(0, lines - visibleLines());
+    verticalScrollBar()->setRange(0, static_cast<int>(maxLine / linesPerStep));
+    verticalScrollBar()->setPageStep(qMax(1, visibleLines() / linesPerStep));
+
+    horizontalScrollBar()->setRange(0, qMax(0, textWidth - viewport()->width() / 2));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+
+    // Place the line bar beside the viewport, as wide as the last line number
+    const int width = lineBarWidth();
+    setViewportMargins(width, 0, 0, 0);
+    const QRect &rect = contentsRect();
+    lineBar->setGeometry(rect.left(), rect.top(), width, rect.height());
+
+    viewport()->update();
+    lineBar->update();
+}
@@ -0,0 +1,548 @@
+#pragma once
+
+#include "PieceTable.h"
+#include "FileUtil.h"
+
+#include <QMainWindow>
+#include <QAbstractScrollArea>
+#include <QGlyphRun>
+#include <QRawFont>
+#include <QHash>
+
+// Forward declarations
+class LargeView;
+class StatusBar;
+class QTextLayout;
+
+/**
+ * @brief Edits a large text file without loading it into a text document.
+ */
+class LargeWindow : public QMainWindow {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Opens a text file in a large window.
+     * @note If the file is already opened, switches to that window.
+     * @param path The full file path.
+     * @param table The file, opened by the loader, or nullptr if it
+     * could not be mapped.
+     * @param line The line to go to, or 0 to keep the cursor in place.
+     * @param column The column to go to, or 0 for the start of the line.
+     */
+    static void open(const QString &path, const std::shared_ptr<PieceTable> &table,
+                     int line = 0, int column = 0);
+
+    /**
+     * @brief Finds the large window that has a file opened.
+     * @param path The file path, which may go through links.
+     * @return The large window that edits the file, or nullptr.
+     */
+    static LargeWindow *findWindow(const QString &path);
+
+    /**
+     * @brief Raises this window and moves the cursor to a position.
+     * @param line The line to go to, or 0 to keep the cursor in place.
+     * @param column The column to go to, or 0 for the start of the line.
+     */
+    void jumpTo(int line, int column);
+
+    /**
+     * @brief Provides the view that edits the file.
+     * @return The view.
+     */
+    LargeView *getView() const;
+
+    /**
+     * @brief Saves the file.
+     * @return true if the file is saved; false otherwise.
+     */
+    bool save();
+
+    /**
+     * @brief Opens a file dialog to select the save location.
+     */
+    void saveAs();
+
+    /**
+     * @brief Prompts the user to go to a specific line.
+     */
+    void goTo();
+
+    /**
+     * @brief Applies the editor font, zoom, line numbers and status bar
+     * settings to all large windows.
+     */
+    static void applySettings();
+
+protected:
+    void closeEvent(QCloseEvent *event) override;
+
+private:
+    LargeView *view;
+    StatusBar *statusBar;
+
+    QString filePath;   // The file path
+    QString fileName;   // The file name
+
+    FileId fileId;          // Identity of the file in the registry
+    QString canonicalPath;  // Canonical path of the file in the registry
+
+    // Store all 'LargeWindow' instances
+    static QList<LargeWindow *> windows;
+    // Find the window of an opened file by its identity or canonical path,
+    // the same way as text windows
+    static QHash<FileId, LargeWindow *> idIndex;
+    static QHash<QString, LargeWindow *> pathIndex;
+
+    /**
+     * @brief Initializes a new 'LargeWindow' instance.
+     * @param path The full file path.
+     * @param table The opened file, or nullptr.
+     */
+    LargeWindow(const QString &path, const std::shared_ptr<PieceTable> &table);
+
+    /**
+     * @brief Updates the window title to show whether the file is saved.
+     */
+    void updateTitle();
+
+    /**
+     * @brief Opens the file again after another program truncated it.
+     */
+    void reopen();
+
+    /**
+     * @brief Updates the position and memory displayed in the status bar.
+     */
+    void updatePos();
+
+    /**
+     * @brief Indexes the opened file again, after it is opened or saved.
+     */
+    void registerFile();
+
+    /**
+     * @brief Removes the opened file from the index.
+     */
+    void unregisterFile();
+};
+
+/**
+ * @brief Renders the lines of a piece table that are on screen,
+ * in the look of the editor and its line bar.
+ * @note In a monospace font, lines of plain ASCII are not shaped: their
+ * glyphs, cursor positions and hit-testing follow from the advance width.
+ * Other lines are laid out without shaping too, as in the editor, unless
+ * they need it, so no line forms ligatures. Long lines are laid out in spans, so only the part on screen is decoded.
+ */
+class LargeView : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Initializes a new 'LargeView' instance.
+     * @param opened The opened file, or nullptr if it could not be mapped.
+     * @param parent The parent widget.
+     */
+    LargeView(const std::shared_ptr<PieceTable> &opened, QWidget *parent);
+
+    /**
+     * @brief Checks whether the file is mapped into memory.
+     * @return true if the file content is available; false otherwise.
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Checks whether the text differs from the saved file.
+     * @return true if the text is modified; false otherwise.
+     */
+    bool isModified() const;
+
+    /**
+     * @brief Writes the text to a file and marks it as unmodified.
+     * @note The undo history is cleared, as the saved file replaces the
+     * one that its steps point into.
+     * @param path The file path.
+     * @return true if the file is saved; false otherwise.
+     */
+    bool save(const QString &path);
+
+    /**
+     * @brief Estimates the memory used by the text besides the mapped file.
+     * @return The number of bytes.
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * @brief Provides the number of lines.
+     * @return The number of lines.
+     */
+    qint64 lineCount() const;
+
+    /**
+     * @brief Provides the line of the text cursor.
+     * @return The line, starting from 0.
+     */
+    qint64 cursorLine() const;
+
+    /**
+     * @brief Provides the column of the text cursor.
+     * @return The column, starting from 0.
+     */
+    int cursorColumn() const;
+
+    /**
+     * @brief Moves the text cursor to a line.
+     * @param line The line, starting from 0.
+     * @param column The column, starting from 0.
+     */
+    void goTo(qint64 line, int column = 0);
+
+    /**
+     * @brief Checks whether any text is selected.
+     * @return true if there is a selection; false otherwise.
+     */
+    bool hasSelection() const;
+
+    /**
+     * @brief Checks whether there is an edit to undo.
+     * @return true if undo is available; false otherwise.
+     */
+    bool canUndo() const;
+
+    /**
+     * @brief Checks whether there is an undone edit to apply again.
+     * @return true if redo is available; false otherwise.
+     */
+    bool canRedo() const;
+
+    /**
+     * @brief Returns to the text before the last edit.
+     */
+    void undo();
+
+    /**
+     * @brief Applies the last undone edit again.
+     */
+    void redo();
+
+    /**
+     * @brief Moves the selected text to the clipboard.
+     */
+    void cut();
+
+    /**
+     * @brief Copies the selected text to the clipboard.
+     */
+    void copy();
+
+    /**
+     * @brief Replaces the selected text with the clipboard text.
+     */
+    void paste();
+
+    /**
+     * @brief Deletes the selected text.
+     */
+    void removeSelection();
+
+    /**
+     * @brief Selects the whole text.
+     */
+    void selectAll();
+
+    /**
+     * @brief Applies the editor font, zoom and line number settings.
+     */
+    void updateSettings();
+
+signals:
+    /**
+     * @brief Emitted when the text cursor moves.
+     */
+    void positionChanged();
+
+    /**
+     * @brief Emitted when the text becomes modified or unmodified.
+     */
+    void modificationChanged();
+
+    /**
+     * @brief Emitted when the text is dropped because another program
+     * truncated the file.
+     */
+    void fileLost();
+
+protected:
+    bool event(QEvent *event) override;
+    bool viewportEvent(QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void inputMethodEvent(QInputMethodEvent *event) override;
+    QVariant inputMethodQuery(Qt::InputMethodQuery query) const override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void focusInEvent(QFocusEvent *event) override;
+    void focusOutEvent(QFocusEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    /**
+     * @brief An earlier state of the text, and where the cursor was.
+     */
+    struct Step {
+        PieceTable::Snapshot snapshot;
+        qint64 cursor;
+    };
+
+    /**
+     * @brief A part of a line that is laid out on its own.
+     * @note Lines up to 'LINE_SPAN' bytes are a single span. Longer lines
+     * are cut every 'LINE_SPAN' bytes, and each span is placed at the
+     * average width of the characters before it.
+     */
+    struct Span {
+        qint64 start;   // Byte offset of the first character
+        qint64 end;     // Byte offset after the last character
+        qreal x;        // Position, relative to the start of the line
+    };
+
+    /**
+     * @brief A span laid out from the advance width alone.
+     */
+    struct FastSpan {
+        bool valid;         // Whether the span is plain ASCII
+        QList<qreal> xs;    // Position of each character boundary
+        QGlyphRun run;      // The glyphs, ready to draw
+    };
+
+    static constexpr qint64 LINE_SPAN = 16 * 1024;
+
+    std::shared_ptr<PieceTable> table;
+    bool valid;
+    QWidget *lineBar;
+
+    qint64 cursor;      // Byte offset of the text cursor
+    qint64 anchor;      // Byte offset where the selection started
+    qreal targetX;      // Position kept when moving between lines
+    int linesPerStep;   // Lines per scroll bar step, for huge line counts
+    int textWidth;      // Width of the longest line painted so far
+    QByteArray newline; // The line break used by the file
+
+    QList<Step> undoSteps;
+    QList<Step> redoSteps;
+    PieceTable::Snapshot savedSnapshot;
+
+    QRawFont rawFont;
+    QList<quint32> asciiGlyphs;             // Glyph of each printable ASCII character
+    qreal advance;                          // Width of every ASCII glyph
+    qreal ascent;
+    bool monospace;                         // Whether the fast path applies
+    mutable QHash<qint64, FastSpan> fastSpans;  // Spans laid out since the last edit, by start
+    mutable qint64 columnLine;                  // The line whose spans are counted, or -1
+    mutable QList<int> columnStarts;            // Characters before each counted span
+
+    /**
+     * @brief Drops the text if the file can no longer be read.
+     * @return true if the text is still available; false otherwise.
+     */
+    bool checkFile();
+
+    /**
+     * @brief Sets the editor font at the current zoom.
+     */
+    void updateFont();
+
+    /**
+     * @brief Checks whether the font is monospace and caches its ASCII glyphs.
+     */
+    void updateFastPath();
+
+    /**
+     * @brief Lays out a span without shaping, if it is plain ASCII.
+     * @param span The span.
+     * @return The cached layout, which is valid only for plain ASCII spans.
+     * @note The reference is only valid until the next call.
+     */
+    const FastSpan &fastSpan(const Span &span) const;
+
+    /**
+     * @brief Provides the span of a line that contains an offset.
+     * @param line The line, starting from 0.
+     * @param offset The byte offset, which is bounded to the line.
+     * @return The span.
+     */
+    Span spanAt(qint64 line, qint64 offset) const;
+
+    /**
+     * @brief Provides the span of a line under a horizontal position.
+     * @param line The line, starting from 0.
+     * @param x The position, relative to the start of the line.
+     * @return The span.
+     */
+    Span spanAtX(qint64 line, qreal x) const;
+
+    /**
+     * @brief Provides the span to step the cursor within.
+     * @param line The line of the cursor.
+     * @param backward Whether to step backward, past the start of a span.
+     * @return The span.
+     */
+    Span stepSpan(qint64 line, bool backward) const;
+
+    /**
+     * @brief Provides the width the spans of long lines are placed by.
+     * @return The width of an average character.
+     */
+    qreal charWidth() const;
+
+    /**
+     * @brief Provides the horizontal position of an offset in a line.
+     * @param line The line, starting from 0.
+     * @param offset The byte offset.
+     * @return The position, relative to the start of the line.
+     */
+    qreal cursorX(qint64 line, qint64 offset) const;
+
+    /**
+     * @brief Finds the offset nearest to a horizontal position in a line.
+     * @param line The line, starting from 0.
+     * @param x The position, relative to the start of the line.
+     * @return The byte offset.
+     */
+    qint64 offsetAtX(qint64 line, qreal x) const;
+
+    /**
+     * @brief Provides the line displayed on the top of the viewport.
+     * @return The top line.
+     */
+    qint64 topLine() const;
+
+    /**
+     * @brief Provides the number of lines that fit in the viewport.
+     * @return The number of visible lines.
+     */
+    int visibleLines() const;
+
+    /**
+     * @brief Provides the end of a line, before any carriage return.
+     * @param line The line, starting from 0.
+     * @return The byte offset after the last character.
+     */
+    qint64 contentEnd(qint64 line) const;
+
+    /**
+     * @brief Lays out a span of text for painting and cursor movement.
+     * @param layout Receives the laid out span.
+     * @param span The span.
+     */
+    void layoutSpan(QTextLayout &layout, const Span &span) const;
+
+    /**
+     * @brief Converts a character index in a span to a byte offset.
+     * @param span The span.
+     * @param index The character index in the span.
+     * @return The byte offset.
+     */
+    qint64 spanOffset(const Span &span, int index) const;
+
+    /**
+     * @brief Converts a byte offset to a character index in a span.
+     * @param span The span.
+     * @param offset The byte offset, within the span.
+     * @return The character index in the span.
+     */
+    int spanIndex(const Span &span, qint64 offset) const;
+
+    /**
+     * @brief Provides the number of characters in a span.
+     * @param span The span.
+     * @return The number of UTF-16 characters.
+     */
+    int spanLength(const Span &span) const;
+
+    /**
+     * @brief Provides the number of characters before a span of a line.
+     * @note The counts are cached for one line until the next edit, so
+     * the cursor column of a long line is counted only once.
+     * @param line The line, starting from 0.
+     * @param number The number of the span in the line, starting from 0.
+     * @return The number of UTF-16 characters.
+     */
+    int charsBefore(qint64 line, qint64 number) const;
+
+    /**
+     * @brief Converts a character index in a line to a byte offset.
+     * @param line The line, starting from 0.
+     * @param index The character index in the line.
+     * @return The byte offset.
+     */
+    qint64 offsetAt(qint64 line, int index) const;
+
+    /**
+     * @brief Converts a byte offset to a character index in its line.
+     * @param offset The byte offset.
+     * @return The character index in the line.
+     */
+    int indexAt(qint64 offset) const;
+
+    /**
+     * @brief Finds the byte offset under a point in the viewport.
+     * @param pos The point.
+     * @return The byte offset.
+     */
+    qint64 offsetAt(const QPoint &pos) const;
+
+    /**
+     * @brief Moves the text cursor and scrolls it into view.
+     * @param offset The new byte offset.
+     * @param keepAnchor Whether to extend the selection.
+     * @param keepX Whether to keep the position for moving between lines.
+     */
+    void moveCursor(qint64 offset, bool keepAnchor = false, bool keepX = false);
+
+    /**
+     * @brief Moves the text cursor by whole lines.
+     * @param count The number of lines, negative to move up.
+     * @param keepAnchor Whether to extend the selection.
+     */
+    void moveLines(qint64 count, bool keepAnchor);
+
+    /**
+     * @brief Replaces the selected text, recording an undo step.
+     * @param bytes The UTF-8 text to insert.
+     */
+    void replaceSelection(const QByteArray &bytes);
+
+    /**
+     * @brief Removes a byte range, recording an undo step.
+     * @param from The offset of the first byte.
+     * @param to The offset after the last byte.
+     */
+    void removeRange(qint64 from, qint64 to);
+
+    /**
+     * @brief Returns to a recorded state of the text.
+     * @param from The steps to take the state from.
+     * @param to The steps that receive the current state.
+     */
+    void restoreStep(QList<Step> &from, QList<Step> &to);
+
+    /**
+     * @brief Provides the width of the line bar.
+     * @return The width, or 0 if line numbers are hidden.
+     */
+    int lineBarWidth() const;
+
+    /**
+     * @brief Paints the line numbers of the visible lines.
+     */
+    void paintLineBar();
+
+    /**
+     * @brief Updates the scroll bars and margins after editing or resizing.
+     */
+    void updateScrollBars();
+};
@@ -0,0 +1,110 @@
+#include "Loader.h"
+#include "MainWindow.h"
+#include "HexWindow.h"
+#include "LargeWindow.h"
+#include "FileUtil.h"
+#include "Attr.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QThreadPool>
+
+// Number of files read at the same time
+static constexpr int MAX_THREADS = 4;
+
+QList<QPointer<MainWindow>> Loader::pending;
+int Loader::running = 0;
+
+void Loader::enqueue(MainWindow *win) {
+    pending.append(win);
+
+    // Wait for the event loop, so the whole batch is queued and
+    // the windows are shown before choosing what to load first
+    QMetaObject::invokeMethod(QCoreApplication::instance(), &Loader::startNext,
+                              Qt::QueuedConnection);
+}
+
+QThreadPool *Loader::pool() {
+    // A few threads at most, so a large batch does not flood the disk
+    static QThreadPool *pool = [] {
+        auto pool = new QThreadPool;
+        pool->setMaxThreadCount(MAX_THREADS);
+        return pool;
+    }();
+    return pool;
+}
+
+void Loader::startNext() {
+    while (running < MAX_THREADS) {
+        // Forget windows closed while waiting
+        pending.removeAll(nullptr);
+        if (pending.isEmpty()) {
+            return;
+        }
+
+        // Pick the most urgent window, in queue order among equals
+        qsizetype next = 0;
+        for (qsizetype i = 1; i < pending.size(); i++) {
+            if (priority(pending[i]) < priority(pending[next])) {
+                next = i;
+            }
+        }
+        const QPointer<MainWindow> win = pending.takeAt(next);
+        const QString &path = win->getFilePath();
+        // Files open in the large file view when the user asks for it,
+        // or from the size the user chose, if any
+        const bool forceLarge = win->opensLarge();
+        const qint64 largeSize = qint64(Attr::get().largeFileSize) * 1024 * 1024;
+
+        running++;
+        pool()->start([win, path, forceLarge, largeSize] {
+            const bool binary = FileUtil::isBinary(path);
+            const bool large = !binary &&
+                (forceLarge || (largeSize > 0 && QFileInfo{path}.size() >= largeSize));
+            const QString &text = (binary || large) ? QString{} : FileUtil::readAll(path);
+
+            // Map and index large files here, as it reads the whole file
+            std::shared_ptr<PieceTable> table;
+            if (large) {
+                table = std::make_shared<PieceTable>();
+                if (!table->open(path)) {
+                    table.reset();
+                }
+            }
+
+            // Display the result on the GUI thread
+            QMetaObject::invokeMethod(QCoreApplication::instance(),
+                                      [win, path, binary, large, text, table] {
+                running--;
+                if (win) {
+                    // Display binary files in a read-only hex view, so they
+                    // are neither decoded as text nor corrupted on save
+                    if (binary) {
+                        HexWindow::open(path);
+                        win->close();
+                    // Edit large files in a piece table over the mapped file,
+                    // instead of copying them into a text document
+                    } else if (large) {
+                        int line, column, scroll;
+                        win->getView(line, column, scroll);
+                        LargeWindow::open(path, table, line, column);
+                        win->close();
+                    } else {
+                        win->finishLoad(text);
+                    }
+                }
+                startNext();
+            });
+        });
+    }
+}
+
+int Loader::priority(const MainWindow *win) {
+    if (win->isActiveWindow()) {
+        return 0;
+    }
+    if (win->isVisible() && !win->isMinimized()) {
+        return 1;
+    }
+    return 2;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QList>
+#include <QPointer>
+
+// Forward declarations
+class MainWindow;
+class QThreadPool;
+
+/**
+ * @brief Reads the files of placeholder windows in the background.
+ * @note The focused window is loaded first, then the visible ones,
+ * then the rest, with only a few files read at a time.
+ */
+class Loader {
+public:
+    /**
+     * @brief Queues a placeholder window for loading.
+     * @param win The window, created with a deferred load.
+     */
+    static void enqueue(MainWindow *win);
+
+private:
+    Loader() = delete;      // Prevent instantiation
+
+    static QList<QPointer<MainWindow>> pending;
+    static int running;
+
+    /**
+     * @brief Provides the thread pool that reads the files.
+     * @return The loader thread pool.
+     */
+    static QThreadPool *pool();
+
+    /**
+     * @brief Starts reading the most urgent files while threads are free.
+     */
+    static void startNext();
+
+    /**
+     * @brief Ranks a window by how soon its file is needed.
+     * @param win The window.
+     * @return 0 for the focused window, 1 for other visible windows,
+     * and 2 for the rest.
+     */
+    static int priority(const MainWindow *win);
+};
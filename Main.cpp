@@ -2,24 +2,79 @@
 #include "MainWindow.h"
 #include "Attr.h"
 #include "FileUtil.h"
+#include "Journal.h"
+#include "IpcUtil.h"
+#include "Resident.h"
+#include "Session.h"
+#include "Startup.h"
 
-#include <QTranslator>
-#include <QLibraryInfo>
-#include <QFontDatabase>
 #include <QTimer>
+#include <QDir>
+
+#include <functional>
 
 /**
  * @brief Processes communication between different program instances.
  * @param message Sent message to the primary instance.
  */
 void processMessage(int, QByteArray message) {
-    if (message == "New") {
+    // Resume from the background before opening windows
+    Resident::wake();
+
+    QString dir;
+    QList<FileTarget> targets;
+    if (IpcUtil::readOpenMessage(message, dir, targets)) {
+        MainWindow::openAll(targets, dir);
+        return;
+    }
+
+    qint64 id;
+    QByteArray data;
+    if (IpcUtil::readStreamMessage(message, id, data)) {
+        MainWindow::appendStream(id, data);
+    } else if (message == "New") {
         MainWindow::newWindow();
     } else if (message.startsWith("Open")) {
         MainWindow::open(message.mid(5));
     }
 }
 
+/**
+ * @brief Provides the messages that forward the arguments to the primary instance.
+ * @note A '-' argument streams the standard input in chunks, ending with an
+ * empty chunk. Each chunk is only read once the previous one is sent.
+ * @param args The program arguments.
+ * @return A function that writes the next message, or returns false when done.
+ */
+std::function<bool(QByteArray &)> launchMessages(const QStringList &args) {
+    QStringList paths = args.mid(1);
+    const bool readStdin = paths.removeAll("-") > 0;
+    const qint64 id = QCoreApplication::applicationPid();
+    const QString &dir = QDir::currentPath();
+    // Positions are parsed here, where relative paths can be checked
+    const QList<FileTarget> &targets = IpcUtil::parseTargets(paths, dir);
+
+    // Open a new window only if nothing else is given
+    bool sendPaths = !readStdin || !targets.isEmpty();
+    bool streaming = readStdin;
+
+    return [=] (QByteArray &message) mutable {
+        if (sendPaths) {
+            sendPaths = false;
+            // Send all files given by the arguments in one message
+            message = targets.isEmpty() ? "New" : IpcUtil::openMessage(dir, targets);
+            return true;
+        }
+        if (streaming) {
+            const QByteArray &chunk = FileUtil::readStdin();
+            streaming = !chunk.isEmpty();
+            message = IpcUtil::streamMessage(id, chunk);
+            return true;
+        }
+        return false;
+    };
+}
+
 /**
  * @brief Sets up the program, then starts the game.
  * @param argc Number of arguments.
@@ -27,19 +82,40 @@ void processMessage(int, QByteArray message) {
  * @return Execution code.
  */
 int main(int argc, char **argv) {
+    Startup::begin();
+
+    // Forward the arguments to a running instance, if any, before loading
+    // the GUI; allow more time for long lists
+    std::function<bool(QByteArray &)> nextMessage;
+    int timeout;
+    int retries;
+    {
+        const QCoreApplication launcher{argc, argv};
+        const QStringList &args = launcher.arguments();
+        nextMessage = launchMessages(args);
+        // A chunk of the standard input is only acknowledged once the
+        // primary instance has appended it, so wait for a busy one
+        const bool streaming = args.contains("-");
+        timeout = streaming ? 5000 : qMax(100, int(args.size()));
+        retries = streaming ? 5 : 0;
+        if (SingleApplication::sendToPrimary(nextMessage, SingleApplication::Mode::User,
+                                             timeout, retries)) {
+            return 0;
+        }
+    }
+
+    Startup::mark("launcher");
+
     SingleApplication app{argc, argv, true};
+    Startup::mark("application");
 
-    // Read the arguments
+    // Another instance may have become the primary instance in the meantime
     if (app.isSecondary()) {
-        // If no arguments are given, open a new window
-        if (argc == 1) {
-            app.sendMessage("New");
-        // Otherwise, open the files given by the arguments
-        } else {
-            for (int i = 1; i < argc; ++i) {
-                app.sendMessage("Open " + QByteArray{argv[i]});
-            }
-        }
+        // The primary instance may still be starting, which only this
+        // instance can wait for
+        QByteArray message;
+        while (nextMessage(message) &&
+               app.sendMessage(message, timeout, SingleApplication::NonBlocking, retries)) {}
         // Exit the secondary instance
         return 0;
     }
@@ -47,53 +123,69 @@ int main(int argc, char **argv) {
     // Load saved attributes if possible
     Attr::get().load();
 
-    // Update the display language
-    QTranslator baseTrans, appTrans;
-    if (Attr::get().lang != Lang::ENGLISH) {
-        const QString basePath{QLibraryInfo::path(QLibraryInfo::TranslationsPath)};
-        const QString code{LangUtil::getLangCode(Attr::get().lang)};
-
-        if (baseTrans.load("qtbase_" + code, basePath)) {
-            app.installTranslator(&baseTrans);
-        }
-        if (appTrans.load(":/i18n/TTT_" + code)) {
-            app.installTranslator(&appTrans);
-        }
-    }
-
-    // For displaying monospaced characters
-    QFontDatabase::addApplicationFont(":/fonts/CascadiaCode.ttf");
-
-    // Style application
+    // Style application; the stylesheet is applied after the first paint
     app.setStyle("Fusion");
-    app.setStyleSheet(FileUtil::readAll(":/conf/Styles.qss"));
+    Startup::mark("attributes");
 
     // Save attributes on quit
     QObject::connect(&app, &QApplication::aboutToQuit, &app, [] {
         Attr::get().save();
     });
+    // Save the open windows if the system session ends with windows open
+    QObject::connect(&app, &QGuiApplication::commitDataRequest, &app, [] {
+        Session::record();
+    });
 
     QObject::connect(&app, &SingleApplication::receivedMessage,
                      &app, &processMessage);
+    // End a stream whose sender went away before its last chunk, so the
+    // window becomes writable again
+    QObject::connect(&app, &SingleApplication::connectionClosed, &app,
+                     [](quint32, const QByteArray &lastMessage) {
+        qint64 id;
+        QByteArray data;
+        if (IpcUtil::readStreamMessage(lastMessage, id, data) && !data.isEmpty()) {
+            MainWindow::appendStream(id, {});
+        }
+    });
 
     // Detect theme change every second
     QTimer themeTimer;
-    QObject::connect(&themeTimer, &QTimer::timeout, &app, [] {
-        // Ensure light/dark mode update
-        QApplication::setStyle("Fusion");
-        MainWindow::updateEditorFont();
-    });
+    QObject::connect(&themeTimer, &QTimer::timeout, &app, &MainWindow::updateTheme);
     themeTimer.start(1000);
 
-    // If no arguments are given, open a new window
-    if (argc == 1) {
-        MainWindow::newWindow();
-    // Otherwise, open the files given by the arguments
-    } else {
-        for (int i = 1; i < argc; ++i) {
-            MainWindow::open(argv[i]);
+    // Optionally keep running in the background after the last window closes
+    Resident::setup(&themeTimer);
+
+    // Restore the documents left unsaved by a crash
+    const auto &recovered = Journal::recover();
+    for (const auto &entry : recovered) {
+        MainWindow::restore(entry.path, entry.text);
+    }
+
+    // Stream the standard input into a new window if '-' is given
+    QStringList paths = app.arguments().mid(1);
+    const bool readStdin = paths.removeAll("-") > 0;
+    if (readStdin) {
+        MainWindow::openStdin();
+    }
+
+    const QString &dir = QDir::currentPath();
+    const QList<FileTarget> &targets = IpcUtil::parseTargets(paths, dir);
+
+    // If no files are given, reopen the previous session, or a new window
+    if (targets.isEmpty()) {
+        if (!readStdin && recovered.isEmpty() && !Session::restore()) {
+            MainWindow::newWindow();
         }
+    // Otherwise, open the files given by the arguments, at their positions
+    } else {
+        MainWindow::openAll(targets, dir);
     }
+    Startup::mark("first window");
+
+    // Load the rest once the first window is on screen
+    Startup::defer();
 
     return app.exec();
 }
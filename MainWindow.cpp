@@ -3,25 +3,53 @@
 #include "MenuBar.h"
 #include "Editor.h"
 #include "StatusBar.h"
+#include "HexWindow.h"
+#include "LargeWindow.h"
+#include "Loader.h"
+#include "Session.h"
+#include "RecentFiles.h"
+#include "Journal.h"
+#include "History.h"
+#include "UndoStore.h"
 #include "Attr.h"
 #include "FileUtil.h"
 
+#include <QCoreApplication>
+#include <QDir>
 #include <QFileDialog>
 #include <QFontDialog>
 #include <QMimeData>
 #include <QMessageBox>
+#include <QScrollBar>
+#include <QSemaphore>
 #include <QShortcut>
+#include <QSplitter>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <limits>
 
 #ifdef Q_OS_WINDOWS
+#define NOMINMAX
 #include <windows.h>
 #endif
 
 QList<MainWindow *> MainWindow::windows;
+QHash<qint64, QPointer<MainWindow>> MainWindow::streams;
+QHash<FileId, MainWindow *> MainWindow::idIndex;
+QHash<QString, MainWindow *> MainWindow::pathIndex;
+bool MainWindow::menusReady = false;
+qint64 MainWindow::focusCounter = 0;
+bool MainWindow::closingAll = false;
 const QString MainWindow::EXT_FILTER =
     QFileDialog::tr("Text Documents (*.txt)") + "\n" +
     QFileDialog::tr("All Files (*.*)");
 
-MainWindow::MainWindow(const QString &path) {
+MainWindow::MainWindow(const QString &path, bool deferLoad)
+    : loaded{!deferLoad}, pendingLine{0}, pendingColumn{0},
+      pendingScroll{-1}, lazyLoad{false}, largeView{false}, staleFlags{0},
+      hibernated{false}, focusTick{0} {
     // Get the full file path
     file = new QFile{path};
     file->open(QFile::ReadWrite | QFile::Text);
@@ -34,21 +62,42 @@ MainWindow::MainWindow(const QString &path) {
 
     // Register this instance
     windows.append(this);
+    registerFile();
 
     resize(1080, 720);
     setAttribute(Qt::WA_DeleteOnClose);
 
     // Place an editor in the center
     editor = new Editor(this);
-    if (!filePath.isEmpty()) {
-        editor->setPlainText(FileUtil::readAll(filePath));
+    if (deferLoad) {
+        // Keep the placeholder read-only until the text arrives
+        editor->setReadOnly(true);
+    } else if (!filePath.isEmpty()) {
+        editor->setFileText(FileUtil::readAll(filePath));
     }
+    updateDiskState();
     connect(editor, &Editor::textChanged, this, &MainWindow::updateSave);
-    setCentralWidget(editor);
-
-    // Place a menu bar on the top
-    menuBar = new MenuBar(this);
-    setMenuBar(menuBar);
+    connect(editor, &Editor::textChanged, this, &MainWindow::scheduleBudget);
+    // Record unsaved edits for crash recovery
+    journal = new Journal{editor->document(), this};
+    journal->reset(filePath);
+    // Remember the lowest edited position to detect append-only changes
+    connect(editor->document(), &QTextDocument::contentsChange,
+            this, [this] (int pos, int, int) {
+        editFloor = qMin(editFloor, pos);
+    });
+    // Stack the panes of the split view
+    splitter = new QSplitter{Qt::Vertical, this};
+    splitter->setChildrenCollapsible(false);
+    splitter->addWidget(editor);
+    splitEditor = nullptr;
+    setCentralWidget(splitter);
+
+    // Place a menu bar on the top, unless it is deferred until after startup
+    menuBar = nullptr;
+    if (menusReady) {
+        makeMenuBar();
+    }
 
     // Place a status bar on the bottom
     statusBar = new StatusBar(this);
@@ -71,9 +120,61 @@ MainWindow::~MainWindow() {
 }
 
 Editor *MainWindow::getEditor() const {
+    if (splitEditor && focusWidget() == splitEditor) {
+        return splitEditor;
+    }
     return editor;
 }
 
+void MainWindow::setSplit(bool split) {
+    if (split == isSplit()) {
+        return;
+    }
+
+    if (!split) {
+        editor->setFocus();
+        delete splitEditor;
+        splitEditor = nullptr;
+        editor->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+        statusBar->updateCursorPos();
+        return;
+    }
+
+    // Show the same document, so nothing is copied or read again
+    splitEditor = new Editor(this);
+    splitEditor->setDocument(editor->document());
+    splitEditor->setReadOnly(editor->isReadOnly());
+    splitter->addWidget(splitEditor);
+    splitter->setSizes({1, 1});
+
+    // Keep both viewports the same width, even when only one pane needs to
+    // scroll, so wrapped lines are not laid out again for each pane
+    editor->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    splitEditor->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+
+    // Start where the first pane is
+    splitEditor->setTextCursor(editor->textCursor());
+    splitEditor->verticalScrollBar()->setValue(editor->verticalScrollBar()->value());
+
+    // Follow the cursor of the focused pane
+    connect(splitEditor, &Editor::cursorPositionChanged,
+            statusBar, &StatusBar::updateCursorPos);
+    splitEditor->installEventFilter(this);
+    editor->installEventFilter(this);
+    splitEditor->setFocus();
+}
+
+bool MainWindow::isSplit() const {
+    return splitEditor != nullptr;
+}
+
+void MainWindow::setReadOnly(bool readOnly) {
+    editor->setReadOnly(readOnly);
+    if (splitEditor) {
+        splitEditor->setReadOnly(readOnly);
+    }
+}
+
 MenuBar *MainWindow::getMenuBar() const {
     return menuBar;
 }
@@ -82,21 +183,41 @@ StatusBar *MainWindow::getStatusBar() const {
     return statusBar;
 }
 
-void MainWindow::open() {
+const QString &MainWindow::getFilePath() const {
+    return filePath;
+}
+
+bool MainWindow::opensLarge() const {
+    return largeView;
+}
+
+void MainWindow::selectFiles(QWidget *parent, bool large) {
     // Prompt the user to select file(s) to open
     const QStringList &paths = QFileDialog::getOpenFileNames(
-        this, QFileDialog::tr("Open"), Attr::get().recentDir, EXT_FILTER);
+        parent, QFileDialog::tr("Open"), Attr::get().recentDir, EXT_FILTER);
 
-    // Open each file in a separate window
-    for (const auto &path : paths) {
-        open(path);
+    if (paths.isEmpty()) {
+        return;
+    }
 
-        // Update the recent directory
-        Attr::get().recentDir = QFileInfo{path}.absolutePath();
+    // Open each file in a separate window, loading them in the background
+    QList<FileTarget> targets;
+    for (const auto &path : paths) {
+        targets.append({path});
     }
+    openAll(targets, QDir::currentPath(), large);
+
+    // Update the recent directory
+    Attr::get().recentDir = QFileInfo{paths.constLast()}.absolutePath();
+    Attr::get().changed();
 }
 
 bool MainWindow::save() {
+    // There is nothing to save before the text is loaded
+    if (!loaded) {
+        return saved;
+    }
+
     // If no file is opened, choose a location to save the editor content
     if (filePath.isEmpty()) {
         saveAs();
@@ -109,6 +230,11 @@ bool MainWindow::save() {
 }
 
 void MainWindow::saveAs() {
+    // There is nothing to save before the text is loaded
+    if (!loaded) {
+        return;
+    }
+
     // Prompt the user to select where to save the file
     const QString &path = QFileDialog::getSaveFileName(
         this, QFileDialog::tr("Save As"), Attr::get().recentDir, EXT_FILTER);
@@ -123,43 +249,39 @@ void MainWindow::saveAs() {
 
     // Update the recent directory
     Attr::get().recentDir = QFileInfo{path}.absolutePath();
+    Attr::get().changed();
 
     // If the selected path is the same as the original path,
     // save the current file
-    if (fullPath == filePath) {
-        save(fullPath);
+    auto opened = findWindow(fullPath);
+    if (opened == this) {
+        save(filePath);
         return;
     }
 
     // If a file is already opened in another window, close that window
-    for (const auto &win : std::as_const(windows)) {
-        if (win->filePath == fullPath) {
-            win->close();
-            break;
-        }
+    if (opened) {
+        opened->close();
     }
 
     filePath = fullPath;
     fileName = QFileInfo{fullPath}.fileName();
-    addRecent(filePath);
+    registerFile();
+    // The new location has never been written by this window
+    diskStamp = {};
+    RecentFiles::add(filePath);
     save(filePath);
 }
 
-void MainWindow::selectNewFont() {
+void MainWindow::selectNewFont(QWidget *parent) {
     bool ok;
     const auto &font = QFontDialog::getFont(
-        &ok, Attr::get().editorFont, this, QFontDialog::tr("Select Font"));
+        &ok, Attr::get().editorFont, parent, QFontDialog::tr("Select Font"));
 
     if (ok) {
         Attr::get().editorFont = font;
-    } else {
-        return;
-    }
-
-    // Update the editor font of every window
-    for (const auto &win : std::as_const(windows)) {
-        win->getEditor()->setFont(font);
-        win->getEditor()->getLineBar()->setFont(font);
+        Attr::get().changed();
+        markStale(STALE_FONT);
     }
 }
 
@@ -167,70 +289,217 @@ void MainWindow::newWindow() {
     new MainWindow();
 }
 
-void MainWindow::open(const QString &path) {
+void MainWindow::restore(const QString &path, const QString &text) {
+    auto win = new MainWindow(path);
+    win->editor->setFileText(text);
+    // Start the new journal from the recovered text
+    win->journal->compact();
+}
+
+MainWindow *MainWindow::reopen(const QString &path, const QString &text,
+                               int line, int column, int scroll) {
+    // Untitled documents have no file, so their text is shown right away
+    if (path.isEmpty()) {
+        auto win = new MainWindow();
+        win->editor->setFileText(text);
+        win->journal->compact();
+        win->editor->goTo(line, column);
+        win->editor->verticalScrollBar()->setValue(scroll);
+        return win;
+    }
+
+    // Read the file once the window is activated, rather than
+    // reading every file of the session during startup
+    auto win = new MainWindow(path, true);
+    win->pendingLine = line;
+    win->pendingColumn = column;
+    win->pendingScroll = scroll;
+    win->lazyLoad = true;
+    return win;
+}
+
+void MainWindow::loadNow() {
+    if (!lazyLoad) {
+        return;
+    }
+    lazyLoad = false;
+    Loader::enqueue(this);
+}
+
+void MainWindow::open(const QString &path, int line, int column) {
     // Get the full file path
     const QString &fullPath = QFileInfo{path}.absoluteFilePath();
 
     // If a file is already opened in another window, switch to that window
-    for (const auto &win : std::as_const(windows)) {
-        if (win->filePath == fullPath) {
-            win->raiseWindow();
-            return;
+    if (auto win = findWindow(fullPath)) {
+        win->jumpTo(line, column);
+        return;
+    }
+
+    load(fullPath, line, column);
+}
+
+void MainWindow::openAll(const QList<FileTarget> &targets, const QString &dir,
+                         bool large) {
+    const QDir baseDir{dir};
+    for (const auto &target : targets) {
+        const QString &fullPath = QDir::cleanPath(baseDir.absoluteFilePath(target.path));
+
+        // If a file is already opened in another window, including one
+        // opened earlier in this batch, switch to that window
+        if (auto win = findWindow(fullPath)) {
+            win->jumpTo(target.line, target.column);
+            continue;
         }
+
+        load(fullPath, target.line, target.column, large);
+    }
+}
+
+void MainWindow::appendStream(qint64 id, const QByteArray &bytes) {
+    // Open a window on the first chunk
+    if (!streams.contains(id)) {
+        auto win = new MainWindow();
+        // Skip undo and crash recovery records while the stream fills the
+        // window, so memory is only spent on the document itself
+        win->editor->setReadOnly(true);
+        win->editor->document()->setUndoRedoEnabled(false);
+        win->journal->pause();
+        streams.insert(id, win);
     }
 
-    addRecent(fullPath);
-    new MainWindow(fullPath);
+    // Skip the chunk if the window was closed in the meantime
+    const auto win = streams.value(id);
+    if (win && !bytes.isEmpty()) {
+        // Drop carriage returns, the same way as reading a file in text mode
+        QString text = win->streamDecoder(bytes);
+        text.remove('\r');
+
+        QTextCursor cursor{win->editor->document()};
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertText(text);
+    }
+
+    // An empty chunk ends the stream
+    if (bytes.isEmpty()) {
+        if (win) {
+            win->setReadOnly(false);
+            win->editor->document()->setUndoRedoEnabled(true);
+            win->journal->resume();
+        }
+        streams.remove(id);
+    }
 }
 
-void MainWindow::addRecent(const QString &path) {
-    // Get the full file path
-    const QString &fullPath = QFileInfo{path}.absoluteFilePath();
+void MainWindow::openStdin() {
+    // Allow a few chunks in flight, so the window fills while the producer
+    // is still writing, without buffering more than the document holds
+    static QSemaphore freeChunks{4};
+    const qint64 id = QCoreApplication::applicationPid();
+
+    auto reader = QThread::create([id] {
+        QByteArray chunk;
+        do {
+            chunk = FileUtil::readStdin();
+            freeChunks.acquire();
+            QMetaObject::invokeMethod(QCoreApplication::instance(), [id, chunk] {
+                appendStream(id, chunk);
+                freeChunks.release();
+            });
+        } while (!chunk.isEmpty());
+    });
+    connect(reader, &QThread::finished, reader, &QThread::deleteLater);
+    reader->start();
+}
 
-    // Ensure there are no duplicate paths
-    if (Attr::get().recentPaths.contains(fullPath)) {
+void MainWindow::load(const QString &fullPath, int line, int column, bool large) {
+    RecentFiles::add(fullPath);
+
+    // Large and binary files are shown in their own windows, outside the
+    // text registry
+    if (auto win = LargeWindow::findWindow(fullPath)) {
+        win->jumpTo(line, column);
+        return;
+    }
+    if (auto win = HexWindow::findWindow(fullPath)) {
+        win->activate();
         return;
     }
 
-    // Update the recent menu of every window
-    for (const auto &win : std::as_const(windows)) {
-        win->menuBar->addRecent(fullPath);
+    // Show the window at once, and read the file in the background
+    auto win = new MainWindow(fullPath, true);
+    win->pendingLine = line;
+    win->pendingColumn = column;
+    win->largeView = large;
+    Loader::enqueue(win);
+}
+
+void MainWindow::jumpTo(int line, int column) {
+    raiseWindow();
+    if (line <= 0) {
+        return;
+    }
+
+    // Jump as soon as the text is loaded
+    if (!loaded) {
+        pendingLine = line;
+        pendingColumn = column;
+        return;
     }
+    editor->goTo(line, column);
+}
+
+void MainWindow::finishLoad(const QString &text) {
+    // Loading the file is not an edit to be recorded
+    journal->pause();
+    editor->setFileText(text);
+    journal->reset(filePath);
+    updateDiskState();
+
+    setReadOnly(false);
+    loaded = true;
+    hibernated = false;
+    // Loading the text marked the file as modified
+    saved = QFileInfo::exists(filePath);
+    updateTitle();
 
-    Attr::get().recentPaths.append(fullPath);
+    // The target line is in the document now
+    if (pendingLine > 0) {
+        editor->goTo(pendingLine, pendingColumn);
+    }
+    if (pendingScroll >= 0) {
+        editor->verticalScrollBar()->setValue(pendingScroll);
+    }
 }
 
-void MainWindow::clearRecent() {
-    // Update the recent menu of every window
-    for (const auto &win : std::as_const(windows)) {
-        win->menuBar->clearRecent();
+void MainWindow::getView(int &line, int &column, int &scroll) const {
+    if (!loaded) {
+        line = pendingLine;
+        column = pendingColumn;
+        scroll = pendingScroll;
+        return;
     }
 
-    Attr::get().recentPaths = {};
+    editor->cursorPos(line, column);
+    scroll = editor->verticalScrollBar()->value();
 }
 
 void MainWindow::showLineNum(bool shown) {
     Attr::get().showLine = shown;
-
-    for (const auto &win : std::as_const(windows)) {
-        win->getEditor()->updateLineBarWidth();
-    }
+    Attr::get().changed();
+    markStale(STALE_LINE);
 }
 
 void MainWindow::showStatus(bool shown) {
     Attr::get().showStatus = shown;
-
-    for (const auto &win : std::as_const(windows)) {
-        win->getStatusBar()->setVisible(shown);
-    }
+    Attr::get().changed();
+    markStale(STALE_STATUS);
 }
 
 void MainWindow::setWordWrap(bool wrap) {
     Attr::get().wordWrap = wrap;
-
-    for (const auto &win : std::as_const(windows)) {
-        win->getEditor()->setWordWrap(wrap);
-    }
+    Attr::get().changed();
+    markStale(STALE_WRAP);
 }
 
 void MainWindow::zoomIn() {
@@ -248,9 +517,19 @@ void MainWindow::resetZoom() {
 void MainWindow::closeEvent(QCloseEvent *event) {
     QMainWindow::closeEvent(event);
 
-    // If the file is already saved, close the window without confirmation
+    // Closing the last window ends the session
+    if (!closingAll && windows.size() == 1) {
+        Session::record();
+    }
+
+    // If the file is already saved, close the window without confirmation;
+    // untitled text is still confirmed, as the next session may not be
+    // restored before the session file is replaced
     if (saved) {
         windows.removeOne(this);
+        unregisterFile();
+        journal->discard();
+        storeUndo();
         event->accept();
         return;
     }
@@ -265,6 +544,9 @@ void MainWindow::closeEvent(QCloseEvent *event) {
     // or if the user selects 'No', close this window
     if ((ans == QMessageBox::Yes && save()) || ans == QMessageBox::No) {
         windows.removeOne(this);
+        unregisterFile();
+        journal->discard();
+        storeUndo();
         event->accept();
     // If the saving is interrupted, or if the user selects 'Cancel',
     // this window will not be closed
@@ -279,22 +561,100 @@ void MainWindow::save(const QString &path) {
         return;
     }
 
-    // Save the file
-    FileUtil::writeAll(path, editor->toPlainText());
+    // Release the lock so that the file can be replaced
+    file->close();
+
+    // Only write the new tail if the rest of the file is left untouched,
+    // otherwise rewrite the whole file
+    bool ok = canAppend(path) && FileUtil::append(path, tailText());
+    if (!ok) {
+        ok = FileUtil::writeAll(path, Editor::fileText(editor->document()));
+    }
+
+    // Lock the file again
+    file->setFileName(path);
+    file->open(QFile::ReadWrite | QFile::Text);
+
+    if (!ok) {
+        QMessageBox::critical(this, AppInfo::name(),
+                              tr("Unable to save %0!").arg(fileName));
+        return;
+    }
 
+    updateDiskState();
+    // Saving may have created the file or replaced it with a new inode
+    registerFile();
+    journal->reset(path);
+    // Keep a copy of this version in the local history
+    History::record(path);
     saved = true;
     updateTitle();
 }
 
+bool MainWindow::canAppend(const QString &path) const {
+    // The text before 'savedChars' must not have been edited
+    if (path != filePath || savedChars <= 0 || editFloor < savedChars) {
+        return false;
+    }
+    // The tail would be cut into segments like the rest of the document
+    if (Editor::hasSegments(editor->document())) {
+        return false;
+    }
+
+    // The file must not have been changed by another program
+    if (diskStamp.size <= 0 || FileUtil::stamp(path) != diskStamp) {
+        return false;
+    }
+    // The tail is written with native line breaks, which would mix with
+    // the file's own, while a rewrite converts all of them
+    return FileUtil::hasNativeLineEnds(path);
+}
+
+QString MainWindow::tailText() const {
+    const auto doc = editor->document();
+    return Editor::plainText(doc, savedChars, doc->characterCount() - 1);
+}
+
+void MainWindow::storeUndo() {
+    // Only a document that matches the file on disk can be restored later
+    if (!saved || filePath.isEmpty() || !editor->document()->isUndoAvailable()) {
+        return;
+    }
+    // The stored positions would count the breaks between segments
+    if (Editor::hasSegments(editor->document())) {
+        return;
+    }
+
+    // Walking through the history must not be shown or tracked, and
+    // leaves the text as it was
+    const int floor = editFloor;
+    setUpdatesEnabled(false);
+    editor->blockSignals(true);
+    UndoStore::save(editor->document(), filePath);
+    editor->blockSignals(false);
+    setUpdatesEnabled(true);
+    editFloor = floor;
+}
+
+void MainWindow::updateDiskState() {
+    diskStamp = filePath.isEmpty() ? FileStamp{} : FileUtil::stamp(filePath);
+    savedChars = editor->document()->characterCount() - 1;
+    editFloor = std::numeric_limits<int>::max();
+}
+
 void MainWindow::updateSave() {
     // If no file is opened, treat the file as 'saved' if the editor is empty
     // Otherwise, the file is unsaved
-    saved = filePath.isEmpty() ? editor->toPlainText().isEmpty() : false;
+    saved = filePath.isEmpty() ? editor->document()->isEmpty() : false;
     updateTitle();
 }
 
 void MainWindow::updateTitle() {
     QString title = fileName + " - " + AppInfo::name();
+    // A hibernated window looks the same until it is focused again
+    if (!loaded && !hibernated) {
+        title = fileName + " " + tr("(Loading...)") + " - " + AppInfo::name();
+    }
     // Unsaved file starts with an asterisk symbol (*)
     if (!saved) {
         title = "*" + title;
@@ -309,25 +669,332 @@ void MainWindow::setZoom(int zoom) {
     }
 
     Attr::get().zoom = zoom;
+    Attr::get().changed();
+    markStale(STALE_FONT);
+}
+
+qint64 MainWindow::memoryUsage() const {
+    // Rough cost of a block beyond its text: its entry in the document
+    // and its text layout
+    static constexpr qint64 BLOCK_OVERHEAD = 256;
+
+    const auto doc = editor->document();
+    return qint64(doc->characterCount()) * qint64(sizeof(QChar)) +
+           qint64(doc->blockCount()) * BLOCK_OVERHEAD;
+}
+
+void MainWindow::setMemoryBudget(int megabytes) {
+    Attr::get().memoryBudget = qMax(0, megabytes);
+    Attr::get().changed();
+    scheduleBudget();
+}
+
+void MainWindow::setLayoutBudget(int megabytes) {
+    Attr::get().layoutBudget = qMax(0, megabytes);
+    Attr::get().changed();
+
+    // Apply a smaller budget to the panes of every window at once
+    for (auto win : std::as_const(windows)) {
+        const auto panes = win->findChildren<Editor *>();
+        for (auto pane : panes) {
+            pane->trimLayouts();
+        }
+    }
+}
+
+void MainWindow::scheduleBudget() {
+    // Check once per burst of edits and loads
+    static bool scheduled = false;
+    if (scheduled) {
+        return;
+    }
+    scheduled = true;
+    QTimer::singleShot(1000, QCoreApplication::instance(), [] {
+        scheduled = false;
+        enforceBudget();
+    });
+}
+
+void MainWindow::enforceBudget() {
+    qint64 total = 0;
+    for (auto win : std::as_const(windows)) {
+        total += win->memoryUsage();
+        win->statusBar->updateMemory();
+    }
+
+    const qint64 budget = qint64(Attr::get().memoryBudget) * 1024 * 1024;
+    if (budget <= 0 || total <= budget) {
+        return;
+    }
+
+    // Hibernate the least recently focused windows first
+    QList<MainWindow *> candidates;
+    for (auto win : std::as_const(windows)) {
+        if (win->canHibernate()) {
+            candidates.append(win);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [] (MainWindow *a, MainWindow *b) {
+        return a->focusTick < b->focusTick;
+    });
 
-    // Update the zoom percentage of every window
-    for (const auto &win : std::as_const(windows)) {
-        win->getEditor()->setZoom(zoom);
-        win->getStatusBar()->updateZoom();
+    for (auto win : std::as_const(candidates)) {
+        if (total <= budget) {
+            break;
+        }
+        total -= win->memoryUsage();
+        win->hibernate();
     }
 }
 
+bool MainWindow::canHibernate() const {
+    // Modified and untitled documents have no copy on disk to read again
+    return loaded && saved && !filePath.isEmpty() &&
+           !editor->isReadOnly() && !isActiveWindow();
+}
+
+void MainWindow::hibernate() {
+    // Neither walking the undo history nor dropping the text is an edit
+    journal->pause();
+
+    // Keep the undo history on disk, the same way as on closing
+    storeUndo();
+
+    // Restore the view once the file is read again
+    getView(pendingLine, pendingColumn, pendingScroll);
+
+    setReadOnly(true);
+    editor->blockSignals(true);
+    editor->clear();
+    editor->blockSignals(false);
+
+    loaded = false;
+    hibernated = true;
+    statusBar->updateMemory();
+}
+
+void MainWindow::markStale(int flags) {
+    for (auto win : std::as_const(windows)) {
+        win->staleFlags |= flags;
+    }
+
+    // Apply right away, then at most once a frame while the changes go on,
+    // so that an auto-repeated zoom shortcut shows each step without
+    // laying out the editor for every key repeat
+    static QTimer *timer = nullptr;
+    static bool pending = false;
+    const auto apply = [] {
+        if (auto win = current()) {
+            win->applyStale();
+        }
+        LargeWindow::applySettings();
+    };
+    if (!timer) {
+        timer = new QTimer{QCoreApplication::instance()};
+        timer->setSingleShot(true);
+        timer->setInterval(16);
+        connect(timer, &QTimer::timeout, timer, [apply] {
+            // Apply the changes made during the last frame
+            if (pending) {
+                pending = false;
+                apply();
+                timer->start();
+                return;
+            }
+            // Once the changes are over, the other windows catch up
+            applyIdle();
+        });
+    }
+
+    if (timer->isActive()) {
+        pending = true;
+        return;
+    }
+    apply();
+    timer->start();
+}
+
+void MainWindow::applyIdle() {
+    // Minimized windows wait until they are restored
+    for (auto win : std::as_const(windows)) {
+        if (win->staleFlags && !win->isMinimized()) {
+            win->applyStale();
+            QTimer::singleShot(0, QCoreApplication::instance(), &MainWindow::applyIdle);
+            return;
+        }
+    }
+}
+
+void MainWindow::applyStale() {
+    for (auto pane : {editor, splitEditor}) {
+        if (!pane) {
+            continue;
+        }
+        if (staleFlags & STALE_FONT) {
+            pane->setZoom(Attr::get().zoom);
+        }
+        if (staleFlags & STALE_WRAP) {
+            pane->setWordWrap(Attr::get().wordWrap);
+        }
+        if (staleFlags & STALE_LINE) {
+            pane->updateLineBarWidth();
+        }
+    }
+    if (staleFlags & STALE_FONT) {
+        statusBar->updateZoom();
+    }
+    if (staleFlags & STALE_STATUS) {
+        statusBar->setVisible(Attr::get().showStatus);
+    }
+    staleFlags = 0;
+}
+
 void MainWindow::updateEditorFont() {
     for (auto win : std::as_const(windows)) {
-        win->editor->setFont(Attr::get().editorFont);
-        win->editor->setZoom(Attr::get().zoom);
+        for (auto pane : {win->editor, win->splitEditor}) {
+            if (pane) {
+                pane->setFont(Attr::get().editorFont);
+                pane->setZoom(Attr::get().zoom);
+            }
+        }
     }
+    LargeWindow::applySettings();
 }
 
-void MainWindow::closeAll() {
+void MainWindow::updateTheme() {
+    // Ensure light/dark mode update
+    QApplication::setStyle("Fusion");
+    updateEditorFont();
+}
+
+void MainWindow::makeMenuBars() {
+    menusReady = true;
+
     for (auto win : std::as_const(windows)) {
+        if (!win->menuBar) {
+            win->makeMenuBar();
+        }
+        // Translate the names given before the translations were loaded
+        if (win->filePath.isEmpty()) {
+            win->fileName = tr("Untitled");
+            win->updateTitle();
+        }
+    }
+}
+
+void MainWindow::makeMenuBar() {
+    menuBar = new MenuBar(this);
+    setMenuBar(menuBar);
+}
+
+void MainWindow::closeAll() {
+    Session::record();
+
+    // Closing a window removes it from the list, so iterate over a copy
+    closingAll = true;
+    const QList<MainWindow *> all{windows};
+    for (auto win : all) {
         win->close();
     }
+    closingAll = false;
+}
+
+MainWindow *MainWindow::findWindow(const QString &path) {
+    // Links and renamed parent directories lead to the same identity
+    const FileId &id = FileUtil::fileId(path);
+    if (id.isValid()) {
+        if (auto win = idIndex.value(id)) {
+            return win;
+        }
+    }
+
+    // Files that do not exist yet are only known by their path
+    return pathIndex.value(FileUtil::canonicalPath(path));
+}
+
+void MainWindow::registerFile() {
+    unregisterFile();
+    if (filePath.isEmpty()) {
+        return;
+    }
+
+    fileId = FileUtil::fileId(filePath);
+    canonicalPath = FileUtil::canonicalPath(filePath);
+    if (fileId.isValid()) {
+        idIndex.insert(fileId, this);
+    }
+    pathIndex.insert(canonicalPath, this);
+}
+
+void MainWindow::unregisterFile() {
+    // Only remove the entries that still point to this window
+    if (fileId.isValid() && idIndex.value(fileId) == this) {
+        idIndex.remove(fileId);
+    }
+    if (!canonicalPath.isEmpty() && pathIndex.value(canonicalPath) == this) {
+        pathIndex.remove(canonicalPath);
+    }
+    fileId = {};
+    canonicalPath.clear();
+}
+
+MainWindow *MainWindow::current() {
+    // Dialogs of a window also count as that window
+    static QPointer<MainWindow> lastActive;
+    for (auto widget = QApplication::activeWindow(); widget; widget = widget->parentWidget()) {
+        if (auto win = qobject_cast<MainWindow *>(widget)) {
+            lastActive = win;
+            return win;
+        }
+    }
+
+    if (lastActive) {
+        return lastActive;
+    }
+    return windows.isEmpty() ? nullptr : windows.constLast();
+}
+
+const QList<MainWindow *> &MainWindow::getWindows() {
+    return windows;
+}
+
+void MainWindow::changeEvent(QEvent *event) {
+    QMainWindow::changeEvent(event);
+
+    if (event->type() == QEvent::ActivationChange && isActiveWindow()) {
+        focusTick = ++focusCounter;
+
+        // Read the file of a restored window once it is first activated
+        loadNow();
+
+        // Read the file of a hibernated window again
+        if (hibernated) {
+            hibernated = false;
+            // The kept view only fits the text that was dropped
+            if (FileUtil::stamp(filePath) != diskStamp) {
+                pendingLine = 0;
+                pendingColumn = 0;
+                pendingScroll = -1;
+            }
+            updateTitle();
+            Loader::enqueue(this);
+        }
+    }
+
+    // Catch up with the settings changed while minimized or in the background
+    if (staleFlags && (event->type() == QEvent::ActivationChange ||
+                       event->type() == QEvent::WindowStateChange) &&
+        !isMinimized()) {
+        applyStale();
+    }
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
+    // Show the cursor of the pane that takes the focus
+    if (event->type() == QEvent::FocusIn && (watched == editor || watched == splitEditor)) {
+        statusBar->updateCursorPos();
+    }
+    return QMainWindow::eventFilter(watched, event);
 }
 
 void MainWindow::raiseWindow() {
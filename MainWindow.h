@@ -3,11 +3,18 @@
 #include <QMainWindow>
 #include <QCloseEvent>
 #include <QFile>
+#include <QPointer>
+#include <QStringDecoder>
+
+#include "FileUtil.h"
+#include "IpcUtil.h"
 
 // Forward declarations
 class MenuBar;
 class Editor;
 class StatusBar;
+class Journal;
+class QSplitter;
 
 /**
  * @brief Displays primary UI elements, including a menu bar on the top,
@@ -19,13 +26,28 @@ class MainWindow : public QMainWindow {
 public:
     /**
      * @brief Provides access to the 'Editor' instance.
+     * @note In split view, this is the pane that was focused last.
      * @return The 'Editor' instance.
      */
     Editor *getEditor() const;
 
+    /**
+     * @brief Shows or hides a second pane over the same document.
+     * @note The panes share the document and its layout,
+     * but each has its own cursor, scroll position and line bar.
+     * @param split Whether to show the second pane.
+     */
+    void setSplit(bool split);
+
+    /**
+     * @brief Checks whether the window is split into two panes.
+     * @return true if the second pane is shown; false otherwise.
+     */
+    bool isSplit() const;
+
     /**
      * @brief Provides access to the 'MenuBar' instance.
-     * @return The 'MenuBar' instance.
+     * @return The 'MenuBar' instance, or nullptr until the startup builds it.
      */
     MenuBar *getMenuBar() const;
 
@@ -35,10 +57,33 @@ public:
      */
     StatusBar *getStatusBar() const;
 
+    /**
+     * @brief Provides the path of the opened file.
+     * @return The full file path, or an empty string if no file is opened.
+     */
+    const QString &getFilePath() const;
+
+    /**
+     * @brief Provides the cursor and scroll position of the editor.
+     * @note Before the file is loaded, the position to restore is given.
+     * @param line Receives the cursor line, starting from 1.
+     * @param column Receives the cursor column, starting from 1.
+     * @param scroll Receives the vertical scroll position.
+     */
+    void getView(int &line, int &column, int &scroll) const;
+
+    /**
+     * @brief Checks whether the file is to be opened in the large file view.
+     * @return true if the user chose the large file view; false otherwise.
+     */
+    bool opensLarge() const;
+
     /**
      * @brief Prompts the user to open file(s).
+     * @param parent The parent of the file dialog.
+     * @param large Whether to open the files in the large file view.
      */
-    void open();
+    static void selectFiles(QWidget *parent, bool large = false);
 
     /**
      * @brief Saves the current file.
@@ -55,30 +100,73 @@ public:
 
     /**
      * @brief Opens a font dialog for selecting a new editor font.
+     * @param parent The parent of the font dialog.
      */
-    void selectNewFont();
+    static void selectNewFont(QWidget *parent);
 
     /**
      * @brief Opens a new window.
      */
     static void newWindow();
 
+    /**
+     * @brief Opens a window with a document recovered after a crash.
+     * @param path The file path, or an empty string for an untitled document.
+     * @param text The recovered text, which is treated as unsaved.
+     */
+    static void restore(const QString &path, const QString &text);
+
+    /**
+     * @brief Opens a window of a saved session.
+     * @note The file is only read once the window is activated,
+     * or when 'loadNow' is called.
+     * @param path The file path, or an empty string for an untitled document.
+     * @param text The text of an untitled document.
+     * @param line The cursor line to restore.
+     * @param column The cursor column to restore.
+     * @param scroll The vertical scroll position to restore.
+     * @return The new window.
+     */
+    static MainWindow *reopen(const QString &path, const QString &text,
+                              int line, int column, int scroll);
+
+    /**
+     * @brief Reads the file of a reopened window without waiting
+     * for the window to be activated.
+     */
+    void loadNow();
+
     /**
      * @brief Opens a file in a new window.
+     * @note If the file is already opened, its window is raised instead.
      * @param path The file path.
+     * @param line The line to go to, or 0 to keep the cursor in place.
+     * @param column The column to go to, or 0 for the start of the line.
+     */
+    static void open(const QString &path, int line = 0, int column = 0);
+
+    /**
+     * @brief Opens several files, each in a new window.
+     * @param targets The files to open, with their positions.
+     * @param dir The directory that relative paths are resolved against.
+     * @param large Whether to open the files in the large file view.
      */
-    static void open(const QString &path);
+    static void openAll(const QList<FileTarget> &targets, const QString &dir,
+                        bool large = false);
 
     /**
-     * @brief Adds a recent file path.
-     * @param path The path of a recently opened file.
+     * @brief Appends a chunk of a stream to its window,
+     * opening a new window on the first chunk.
+     * @note The window stays read-only until the stream ends.
+     * @param id The identifier of the stream.
+     * @param bytes The chunk, or an empty chunk at the end of the stream.
      */
-    static void addRecent(const QString &path);
+    static void appendStream(qint64 id, const QByteArray &bytes);
 
     /**
-     * @brief Clears all recent file paths.
+     * @brief Streams the standard input of this instance into a new window.
      */
-    static void clearRecent();
+    static void openStdin();
 
     /**
      * @brief Shows or hides the line numbers on the left side of the editor.
@@ -119,42 +207,179 @@ public:
      */
     static void updateEditorFont();
 
+    /**
+     * @brief Applies the current light/dark mode to all windows.
+     */
+    static void updateTheme();
+
+    /**
+     * @brief Displays the text of the file, read in the background.
+     * @note The window stays read-only until then.
+     * @param text The file content.
+     */
+    void finishLoad(const QString &text);
+
+    /**
+     * @brief Places menu bars on the windows opened during startup,
+     * and on every window opened from now on.
+     */
+    static void makeMenuBars();
+
     /**
      * @brief Closes all windows, confirming save/discard changes.
+     * @note The windows are saved as the session first.
      */
     static void closeAll();
 
+    /**
+     * @brief Estimates the memory used by the document.
+     * @return The size in bytes, including the text layout.
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * @brief Sets how much memory the documents may use before
+     * background windows hibernate.
+     * @param megabytes The budget in megabytes, or 0 for no limit.
+     */
+    static void setMemoryBudget(int megabytes);
+
+    /**
+     * @brief Sets how much memory each editor may use for block layouts.
+     * @param megabytes The budget in megabytes, or 0 for no limit.
+     */
+    static void setLayoutBudget(int megabytes);
+
+    /**
+     * @brief Provides the window that menu actions apply to.
+     * @return The active window, or the window that was active last.
+     */
+    static MainWindow *current();
+
+    /**
+     * @brief Provides access to all windows.
+     * @return The windows, in the order they were opened.
+     */
+    static const QList<MainWindow *> &getWindows();
+
+    /**
+     * @brief Finds the window that has a file opened.
+     * @param path The file path, which may go through links.
+     * @return The window, or nullptr if the file is not opened.
+     */
+    static MainWindow *findWindow(const QString &path);
+
 protected:
     void closeEvent(QCloseEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private:
+    // Settings that a window has yet to apply
+    enum Stale {
+        STALE_FONT = 1,     // Font and zoom
+        STALE_WRAP = 2,     // Word wrap
+        STALE_LINE = 4,     // Line numbers
+        STALE_STATUS = 8,   // Status bar
+    };
+
     Editor *editor;
+    Editor *splitEditor;    // The second pane, or nullptr if not split
+    QSplitter *splitter;
     MenuBar *menuBar;
     StatusBar *statusBar;
+    Journal *journal;
 
     QFile *file;
     QString filePath;   // The file path
     QString fileName;   // The file name
     bool saved;         // Whether the file is saved
+    bool loaded;        // Whether the file content is displayed
+    int pendingLine;    // Line to go to once loaded, or 0
+    int pendingColumn;  // Column to go to once loaded
+    int pendingScroll;  // Scroll position to restore once loaded, or -1
+    bool lazyLoad;      // Whether the file is read once the window is activated
+    bool largeView;     // Whether the file opens in the large file view
+    int staleFlags;     // Settings changed since the window was laid out
+    bool hibernated;    // Whether the document was dropped to save memory
+    qint64 focusTick;   // When the window was last focused
+
+    FileId fileId;          // Identity of the file in the registry
+    QString canonicalPath;  // Canonical path of the file in the registry
+    FileStamp diskStamp;    // Fingerprint of the file after the last load/save
+    int savedChars;         // Number of characters written to disk
+    int editFloor;          // Lowest position edited since the last load/save
+
+    // Decode streamed chunks, which may split multi-byte characters
+    QStringDecoder streamDecoder{QStringDecoder::Utf8};
 
     // Store all 'MainWindow' instances
     static QList<MainWindow *> windows;
+    // Find the window of an opened file by its identity or canonical path
+    static QHash<FileId, MainWindow *> idIndex;
+    static QHash<QString, MainWindow *> pathIndex;
+    // Whether new windows get a menu bar right away
+    static bool menusReady;
+    // Increases each time a window is focused
+    static qint64 focusCounter;
+    // Whether all windows are being closed, after the session was saved
+    static bool closingAll;
+    // Store the windows of the streams being loaded, by stream identifier;
+    // a window closed during its stream becomes null
+    static QHash<qint64, QPointer<MainWindow>> streams;
     // Extension filter of the file dialog
     static const QString EXT_FILTER;
 
     /**
      * @brief Initializes a new 'MainWindow' instance.
      * @param path The file path.
+     * @param deferLoad Whether the file is read later by 'Loader',
+     * leaving the window empty until then.
      */
-    MainWindow(const QString &path = "");
+    MainWindow(const QString &path = "", bool deferLoad = false);
     ~MainWindow();
 
+    /**
+     * @brief Places a menu bar on the top.
+     */
+    void makeMenuBar();
+
+    /**
+     * @brief Allows or prevents editing in every pane.
+     * @param readOnly Whether the document is read-only.
+     */
+    void setReadOnly(bool readOnly);
+
     /**
      * @brief Saves the file to the specified location.
      * @param The file path.
      */
     void save(const QString &path);
 
+    /**
+     * @brief Checks whether only text after the saved prefix has changed,
+     * and that the prefix on disk is still the one that was saved.
+     * @param path The file path.
+     * @return Whether the new text can be appended to the file.
+     */
+    bool canAppend(const QString &path) const;
+
+    /**
+     * @brief Provides the text added after the saved prefix.
+     * @return The text after the saved prefix.
+     */
+    QString tailText() const;
+
+    /**
+     * @brief Stores the undo history of the file when the window closes.
+     */
+    void storeUndo();
+
+    /**
+     * @brief Records the on-disk state after the file is loaded or saved.
+     */
+    void updateDiskState();
+
     /**
      * @brief Updates the save state when modifying the file.
      */
@@ -171,11 +396,79 @@ private:
      */
     static void setZoom(int zoom);
 
+    /**
+     * @brief Indexes the opened file again, after it is opened or saved.
+     */
+    void registerFile();
+
+    /**
+     * @brief Removes the opened file from the index.
+     */
+    void unregisterFile();
+
+    /**
+     * @brief Checks the memory budget once the current edits are over.
+     */
+    static void scheduleBudget();
+
+    /**
+     * @brief Hibernates the least recently focused windows
+     * while the documents use more memory than the budget.
+     */
+    static void enforceBudget();
+
+    /**
+     * @brief Checks whether the document can be dropped and read again.
+     * @return true if the window shows an unmodified file in the background.
+     */
+    bool canHibernate() const;
+
+    /**
+     * @brief Drops the document, keeping its view and undo history
+     * to restore them when the window is focused again.
+     */
+    void hibernate();
+
+    /**
+     * @brief Marks a changed setting on every window.
+     * @note The active window applies it right away, and at most once
+     * per frame during a burst of changes; the others apply it when
+     * they are shown again, or one at a time once the burst is over.
+     * @param flags The changed settings.
+     */
+    static void markStale(int flags);
+
+    /**
+     * @brief Applies stale settings to one window per event loop iteration.
+     */
+    static void applyIdle();
+
+    /**
+     * @brief Applies the settings that changed since the last layout.
+     */
+    void applyStale();
+
     /**
      * @brief A platform-dependent method to bring this window to front.
      */
     void raiseWindow();
 
+    /**
+     * @brief Opens a file that is not opened in any window yet.
+     * @param fullPath The full file path.
+     * @param line The line to go to, or 0 to keep the cursor in place.
+     * @param column The column to go to, or 0 for the start of the line.
+     * @param large Whether to open the file in the large file view.
+     */
+    static void load(const QString &fullPath, int line, int column, bool large = false);
+
+    /**
+     * @brief Raises this window and moves the cursor to a position.
+     * @param line The line to go to, or 0 to keep the cursor in place.
+     * @param column The column to go to, or 0 for the start of the line.
+     */
+    void jumpTo(int line, int column);
+
     /**
      * @brief Determines the position of the new window, where it would not
      * overlap with previous windows.
@@ -1,47 +1,102 @@
 #include "MenuBar.h"
 #include "AppInfo.h"
 #include "MainWindow.h"
+#include "LargeWindow.h"
 #include "Editor.h"
 #include "StatusBar.h"
 #include "Dialog.h"
+#include "UndoStore.h"
+#include "Resident.h"
+#include "RecentFiles.h"
 #include "Attr.h"
 
 #include <QActionGroup>
+#include <QApplication>
+#include <QClipboard>
+#include <QInputDialog>
 #include <QMessageBox>
+#include <QMimeData>
+
+QMenu *MenuBar::fileMenu = nullptr;
+QMenu *MenuBar::editMenu = nullptr;
+QMenu *MenuBar::viewMenu = nullptr;
+QMenu *MenuBar::helpMenu = nullptr;
+QMenu *MenuBar::recentMenu = nullptr;
+QAction *MenuBar::historyAction = nullptr;
+QAction *MenuBar::undoAction = nullptr;
+QAction *MenuBar::redoAction = nullptr;
+QAction *MenuBar::cutAction = nullptr;
+QAction *MenuBar::copyAction = nullptr;
+QAction *MenuBar::pasteAction = nullptr;
+QAction *MenuBar::delAction = nullptr;
+QAction *MenuBar::findAction = nullptr;
+QAction *MenuBar::findPrevAction = nullptr;
+QAction *MenuBar::findNextAction = nullptr;
+QAction *MenuBar::replaceAction = nullptr;
+QAction *MenuBar::goAction = nullptr;
+QAction *MenuBar::lineAction = nullptr;
+QAction *MenuBar::statusAction = nullptr;
+QAction *MenuBar::wrapAction = nullptr;
+QAction *MenuBar::splitAction = nullptr;
+QMenu *MenuBar::langMenu = nullptr;
+QAction *MenuBar::residentAction = nullptr;
+QAction *MenuBar::diagnosticsAction = nullptr;
+
+MenuBar::MenuBar(QMainWindow *win) : QMenuBar{win} {
+    // Create menus and actions for the first window only
+    makeMenus();
+
+    addMenu(fileMenu);
+    addMenu(editMenu);
+    addMenu(viewMenu);
+    addMenu(helpMenu);
+}
 
-MenuBar::MenuBar(MainWindow *win)
-    : QMenuBar{win}, win{win}, editor{win->getEditor()} {
-    // Create menus and actions
-    makeFileMenu();
-    makeEditMenu();
-    makeViewMenu();
-    makeHelpMenu();
+MainWindow *MenuBar::win() {
+    return MainWindow::current();
 }
 
-void MenuBar::addRecent(const QString &path) {
-    auto action = new QAction{path, this};
-    // Open the file at the corresponding path
-    connect(action, &QAction::triggered, this, [path] {
-        MainWindow::open(path);
-    });
-    // Add the action right on top of the separator
-    recentMenu->insertAction(recentSep, action);
+Editor *MenuBar::editor() {
+    return win()->getEditor();
+}
 
-    recentAction->setEnabled(true);
+LargeWindow *MenuBar::largeWin() {
+    // Dialogs of a window also count as that window
+    for (auto widget = QApplication::activeWindow(); widget; widget = widget->parentWidget()) {
+        if (auto win = qobject_cast<LargeWindow *>(widget)) {
+            return win;
+        }
+    }
+    return nullptr;
 }
 
-void MenuBar::clearRecent() {
-    const auto &actions = recentMenu->actions();
-    // Remove all recent actions
-    for (int i = 0; i < actions.size() - 2; ++i) {
-        recentMenu->removeAction(actions[i]);
+QWidget *MenuBar::activeWin() {
+    if (auto large = largeWin()) {
+        return large;
     }
+    return win();
+}
 
-    recentAction->setEnabled(false);
+void MenuBar::makeMenus() {
+    if (fileMenu) {
+        return;
+    }
+
+    makeFileMenu();
+    makeEditMenu();
+    makeViewMenu();
+    makeHelpMenu();
+
+    // The menus have no parent window, so delete them on quit
+    connect(qApp, &QApplication::aboutToQuit, qApp, [] {
+        for (auto menu : {fileMenu, editMenu, viewMenu, helpMenu}) {
+            delete menu;
+        }
+    });
 }
 
 void MenuBar::makeFileMenu() {
-    auto fileMenu = addMenu(tr("&File"));
+    fileMenu = new QMenu{tr("&File")};
 
     // Open a new window
     fileMenu->addAction(tr("&New..."), QKeySequence("Ctrl+N"), [] {
@@ -49,156 +104,274 @@ void MenuBar::makeFileMenu() {
     });
 
     // Open a file
-    fileMenu->addAction(tr("&Open..."), QKeySequence("Ctrl+O"), [this] {
-        win->open();
+    fileMenu->addAction(tr("&Open..."), QKeySequence("Ctrl+O"), [] {
+        MainWindow::selectFiles(activeWin());
+    });
+
+    // Open a file without loading it into a text document
+    fileMenu->addAction(tr("Open as &Large File..."), [] {
+        MainWindow::selectFiles(activeWin(), true);
     });
 
-    // Display the paths of recently opened files
+    // Display the paths of recently opened files, filled when shown
     recentMenu = fileMenu->addMenu(tr("Open &Recent"));
-    // Separate the paths and the 'Clear Recent' action
-    recentSep = recentMenu->addSeparator();
-    // Clear all recent paths
-    recentAction = recentMenu->addAction(tr("&Clear Menu"), &MainWindow::clearRecent);
-    recentAction->setEnabled(!Attr::get().recentPaths.isEmpty());
-    // Add all recent paths
-    for (const auto &path : Attr::get().recentPaths) {
-        addRecent(path);
-    }
+    connect(recentMenu, &QMenu::aboutToShow, recentMenu, &MenuBar::updateRecentMenu);
 
     // Save a file
-    fileMenu->addAction(tr("&Save"), QKeySequence("Ctrl+S"), [this] {
-        win->save();
+    fileMenu->addAction(tr("&Save"), QKeySequence("Ctrl+S"), [] {
+        if (auto large = largeWin()) {
+            large->save();
+        } else {
+            win()->save();
+        }
     });
 
     // Save a file to a custom location
     fileMenu->addAction(tr("Save &As..."),
-                        QKeySequence("Ctrl+Shift+S"), [this] {
-        win->saveAs();
+                        QKeySequence("Ctrl+Shift+S"), [] {
+        if (auto large = largeWin()) {
+            large->saveAs();
+        } else {
+            win()->saveAs();
+        }
+    });
+
+    // Display the saved versions of the file
+    historyAction = fileMenu->addAction(tr("&History..."), [] {
+        // Only files on disk have a history, and large files have none
+        if (largeWin() || win()->getFilePath().isEmpty()) {
+            return;
+        }
+        auto dialog = new HistoryDialog(win());
+        dialog->show();
+    });
+    connect(fileMenu, &QMenu::aboutToShow, fileMenu, [] {
+        historyAction->setEnabled(!largeWin() && !win()->getFilePath().isEmpty());
     });
 
     fileMenu->addSeparator();
 
     // Close the window (on Windows only; macOS has a built-in 'Quit' action)
 #ifdef Q_OS_WINDOWS
-    fileMenu->addAction(tr("E&xit"), [this] {
-        win->close();
+    fileMenu->addAction(tr("E&xit"), [] {
+        activeWin()->close();
     });
 #endif
 }
 
+void MenuBar::updateRecentMenu() {
+    recentMenu->clear();
+
+    const auto &paths = RecentFiles::paths();
+    for (const auto &path : paths) {
+        // Open the file at the corresponding path
+        recentMenu->addAction(path, [path] {
+            MainWindow::open(path);
+        });
+    }
+
+    // Separate the paths and the 'Clear Menu' action
+    recentMenu->addSeparator();
+    // Clear all recent paths
+    auto clearAction = recentMenu->addAction(tr("&Clear Menu"), &RecentFiles::clear);
+    clearAction->setEnabled(!paths.isEmpty());
+
+    // Files deleted in the meantime are left out the next time
+    RecentFiles::validate();
+}
+
 void MenuBar::makeEditMenu() {
-    auto editMenu = addMenu(tr("&Edit"));
+    editMenu = new QMenu{tr("&Edit")};
     // Enable or disable actions upon opening the editing menu
-    connect(editMenu, &QMenu::aboutToShow, this, [this] {
-        bool hasSelection = editor->textCursor().hasSelection();
-        cutAction->setEnabled(hasSelection);
-        copyAction->setEnabled(hasSelection);
-        pasteAction->setEnabled(editor->canPaste());
-        delAction->setEnabled(hasSelection);
-        findPrevAction->setEnabled(!Attr::get().findTarget.isEmpty());
-        findNextAction->setEnabled(!Attr::get().findTarget.isEmpty());
-        goAction->setEnabled(!Attr::get().wordWrap);
+    connect(editMenu, &QMenu::aboutToShow, editMenu, &MenuBar::updateEditMenu);
+    // Keep the shortcuts working in every window once the menu is closed;
+    // each action checks the active editor itself
+    connect(editMenu, &QMenu::aboutToHide, editMenu, [] {
+        const auto actions = editMenu->actions();
+        for (auto action : actions) {
+            action->setEnabled(true);
+        }
     });
 
     // Undo a change
-    auto undoAction = editMenu->addAction(tr("&Undo"), QKeySequence("Ctrl+Z"), [this] {
-        editor->undo();
-    });
-    undoAction->setEnabled(false);
-    connect(editor, &Editor::undoAvailable, this, [undoAction] (bool b) {
-        undoAction->setEnabled(b);
+    undoAction = editMenu->addAction(tr("&Undo"), QKeySequence("Ctrl+Z"), [] {
+        if (auto large = largeWin()) {
+            large->getView()->undo();
+        } else {
+            editor()->undo();
+        }
     });
 
     // Redo a change
-    auto redoAction = editMenu->addAction(tr("&Redo"), QKeySequence("Ctrl+Y"), [this] {
-        editor->redo();
-    });
-    redoAction->setEnabled(false);
-    connect(editor, &Editor::redoAvailable, this, [redoAction] (bool b) {
-        redoAction->setEnabled(b);
+    redoAction = editMenu->addAction(tr("&Redo"), QKeySequence("Ctrl+Y"), [] {
+        if (auto large = largeWin()) {
+            large->getView()->redo();
+        } else {
+            editor()->redo();
+        }
     });
 
     editMenu->addSeparator();
 
     // Cut the selected text into the clipboard
-    cutAction = editMenu->addAction(tr("Cu&t"), QKeySequence("Ctrl+X"), [this] {
-        editor->cut();
+    cutAction = editMenu->addAction(tr("Cu&t"), QKeySequence("Ctrl+X"), [] {
+        if (auto large = largeWin()) {
+            large->getView()->cut();
+        } else {
+            editor()->cut();
+        }
     });
 
     // Copy the selected text into the clipboard
-    copyAction = editMenu->addAction(tr("&Copy"), QKeySequence("Ctrl+C"), [this] {
-        editor->copy();
+    copyAction = editMenu->addAction(tr("&Copy"), QKeySequence("Ctrl+C"), [] {
+        if (auto large = largeWin()) {
+            large->getView()->copy();
+        } else {
+            editor()->copy();
+        }
     });
 
     // Paste the clipboard into the editor
-    pasteAction = editMenu->addAction(tr("&Paste"), QKeySequence("Ctrl+V"), [this] {
-        editor->paste();
+    pasteAction = editMenu->addAction(tr("&Paste"), QKeySequence("Ctrl+V"), [] {
+        if (auto large = largeWin()) {
+            large->getView()->paste();
+        } else {
+            editor()->paste();
+        }
     });
 
     // Delete the selected text
-    delAction = editMenu->addAction(tr("De&lete"), QKeySequence("Del"), [this] {
-        editor->textCursor().removeSelectedText();
+    delAction = editMenu->addAction(tr("De&lete"), QKeySequence("Del"), [] {
+        if (auto large = largeWin()) {
+            large->getView()->removeSelection();
+        } else {
+            editor()->textCursor().removeSelectedText();
+        }
     });
 
     editMenu->addSeparator();
 
-    // Find a text snippet
-    editMenu->addAction(tr("&Find..."), QKeySequence("Ctrl+F"), [this] {
-        auto dialog = new FindDialog(win);
+    // Find a text snippet; large files are not searched
+    findAction = editMenu->addAction(tr("&Find..."), QKeySequence("Ctrl+F"), [] {
+        if (largeWin()) {
+            return;
+        }
+        auto dialog = new FindDialog(win());
         dialog->show();
     });
 
     // Find the previous occurrence of a text snippet
-    findPrevAction = editMenu->addAction(tr("Find Pre&vious"), QKeySequence("Shift+F3"), [this] {
+    findPrevAction = editMenu->addAction(tr("Find Pre&vious"), QKeySequence("Shift+F3"), [] {
+        if (largeWin()) {
+            return;
+        }
         // If the text snippet is unspecified,
         // prompt the user to enter one in the find dialog
         if (Attr::get().findTarget.isEmpty()) {
-            auto dialog = new FindDialog(win);
+            auto dialog = new FindDialog(win());
             dialog->show();
-        } else if (editor->findPrev().isNull()) {
-            editor->showFindError();
+        } else if (editor()->findPrev().isNull()) {
+            editor()->showFindError();
         }
     });
 
     // Find the next occurrence of a text snippet
-    findNextAction = editMenu->addAction(tr("Find &Next"), QKeySequence("F3"), [this] {
+    findNextAction = editMenu->addAction(tr("Find &Next"), QKeySequence("F3"), [] {
+        if (largeWin()) {
+            return;
+        }
         // If the text snippet is unspecified,
         // prompt the user to enter one in the find dialog
         if (Attr::get().findTarget.isEmpty()) {
-            auto dialog = new FindDialog(win);
+            auto dialog = new FindDialog(win());
             dialog->show();
-        } else if (editor->findNext().isNull()) {
-            editor->showFindError();
+        } else if (editor()->findNext().isNull()) {
+            editor()->showFindError();
         }
     });
 
     // Replace a text snippet
-    editMenu->addAction(tr("&Replace..."), QKeySequence("Ctrl+H"), [this] {
-        auto dialog = new ReplaceDialog(win);
+    replaceAction = editMenu->addAction(tr("&Replace..."), QKeySequence("Ctrl+H"), [] {
+        if (largeWin()) {
+            return;
+        }
+        auto dialog = new ReplaceDialog(win());
         dialog->show();
     });
 
     editMenu->addSeparator();
 
     // Select all text in the editor
-    editMenu->addAction(tr("Select &All"), QKeySequence("Ctrl+A"), [this] {
-        editor->selectAll();
+    editMenu->addAction(tr("Select &All"), QKeySequence("Ctrl+A"), [] {
+        if (auto large = largeWin()) {
+            large->getView()->selectAll();
+        } else {
+            editor()->selectAll();
+        }
     });
 
     // Go to a specific line in the editor
-    goAction = editMenu->addAction(tr("&Go To..."), QKeySequence("Ctrl+G"), [this] {
-        auto dialog = new GoToDialog(win);
+    goAction = editMenu->addAction(tr("&Go To..."), QKeySequence("Ctrl+G"), [] {
+        if (auto large = largeWin()) {
+            large->goTo();
+            return;
+        }
+        // Lines cannot be counted while words wrap
+        if (Attr::get().wordWrap) {
+            return;
+        }
+        auto dialog = new GoToDialog(win());
         dialog->show();
     });
 }
 
+void MenuBar::updateEditMenu() {
+    if (auto large = largeWin()) {
+        auto view = large->getView();
+        cutAction->setEnabled(view->hasSelection());
+        copyAction->setEnabled(view->hasSelection());
+        delAction->setEnabled(view->hasSelection());
+        pasteAction->setEnabled(QApplication::clipboard()->mimeData()->hasText());
+        undoAction->setEnabled(view->canUndo());
+        redoAction->setEnabled(view->canRedo());
+        for (auto action : {findAction, findPrevAction, findNextAction, replaceAction}) {
+            action->setEnabled(false);
+        }
+        return;
+    }
+
+    auto editor = MenuBar::editor();
+    bool hasSelection = editor->textCursor().hasSelection();
+    cutAction->setEnabled(hasSelection);
+    copyAction->setEnabled(hasSelection);
+    pasteAction->setEnabled(editor->canPaste());
+    delAction->setEnabled(hasSelection);
+    findPrevAction->setEnabled(!Attr::get().findTarget.isEmpty());
+    findNextAction->setEnabled(!Attr::get().findTarget.isEmpty());
+    goAction->setEnabled(!Attr::get().wordWrap);
+
+    // The history stored when the file was last closed can also be undone
+    undoAction->setEnabled(editor->document()->isUndoAvailable() ||
+                           UndoStore::exists(win()->getFilePath()));
+    redoAction->setEnabled(editor->document()->isRedoAvailable());
+}
+
 void MenuBar::makeViewMenu() {
-    auto viewMenu = addMenu(tr("&View"));
+    viewMenu = new QMenu{tr("&View")};
     // Enable or disable actions upon opening the editing menu
-    connect(viewMenu, &QMenu::aboutToShow, this, [this] {
+    connect(viewMenu, &QMenu::aboutToShow, viewMenu, [] {
         lineAction->setChecked(Attr::get().showLine);
         statusAction->setChecked(Attr::get().showStatus);
         wrapAction->setChecked(Attr::get().wordWrap);
+
+        // Large windows neither wrap nor split
+        wrapAction->setEnabled(!largeWin());
+        splitAction->setEnabled(!largeWin());
+    });
+    // Keep the shortcuts working in every window once the menu is closed
+    connect(viewMenu, &QMenu::aboutToHide, viewMenu, [] {
+        wrapAction->setEnabled(true);
+        splitAction->setEnabled(true);
     });
 
     // Show or hide the line numbers
@@ -216,7 +389,17 @@ void MenuBar::makeViewMenu() {
                                      QKeySequence("Alt+W"), &MainWindow::setWordWrap);
     wrapAction->setCheckable(true);
 
-    // The 'Zoom' menu
+    // Show or hide the second pane; the action is shared by all windows,
+    // so it toggles the active window rather than holding a checked state
+    splitAction = viewMenu->addAction(tr("S&plit View"), QKeySequence("Alt+P"), [] {
+        if (largeWin()) {
+            return;
+        }
+        win()->setSplit(!win()->isSplit());
+    });
+
+    // The 'Zoom' menu; its actions are created right away,
+    // as their shortcuts must work before the menu is ever shown
     auto zoomMenu = viewMenu->addMenu(tr("&Zoom"));
 
     // Increase the editor font size
@@ -230,18 +413,107 @@ void MenuBar::makeViewMenu() {
 }
 
 void MenuBar::makeHelpMenu() {
-    auto helpMenu = addMenu(tr("&Help"));
+    helpMenu = new QMenu{tr("&Help")};
+    // Enable or disable actions upon opening the help menu
+    connect(helpMenu, &QMenu::aboutToShow, helpMenu, [] {
+        diagnosticsAction->setEnabled(!largeWin());
+    });
 
     // Select an editor font
-    helpMenu->addAction(tr("Editor &Font"), [this] {
-        win->selectNewFont();
+    helpMenu->addAction(tr("Editor &Font"), [] {
+        MainWindow::selectNewFont(activeWin());
+    });
+
+    // Select displayed language, filled when first shown
+    langMenu = helpMenu->addMenu(tr("&Language"));
+    connect(langMenu, &QMenu::aboutToShow, langMenu, &MenuBar::makeLangMenu);
+
+    helpMenu->addSeparator();
+
+    // Keep the program running after the last window closes,
+    // so that it reopens instantly
+    residentAction = helpMenu->addAction(tr("Keep Running in &Background"));
+    residentAction->setCheckable(true);
+    residentAction->setChecked(Attr::get().resident);
+    connect(residentAction, &QAction::toggled, residentAction, &Resident::setEnabled);
+
+    // Select how long to keep running in the background
+    helpMenu->addAction(tr("Background &Timeout..."), [] {
+        bool ok;
+        const int minutes = QInputDialog::getInt(
+            activeWin(), AppInfo::name(),
+            tr("Minutes to keep running in the background (0 for no limit):"),
+            Attr::get().residentTimeout, 0, 24 * 60, 1, &ok);
+        if (ok) {
+            Resident::setTimeout(minutes);
+        }
+    });
+
+    // Select how much memory the documents may use
+    helpMenu->addAction(tr("Memory &Budget..."), [] {
+        bool ok;
+        const int megabytes = QInputDialog::getInt(
+            activeWin(), AppInfo::name(),
+            tr("Megabytes of documents to keep in memory (0 for no limit):"),
+            Attr::get().memoryBudget, 0, 1024 * 1024, 64, &ok);
+        if (ok) {
+            MainWindow::setMemoryBudget(megabytes);
+        }
     });
 
-    // Select displayed language
-    auto langMenu = helpMenu->addMenu(tr("&Language"));
+    // Select how much memory each editor may use for block layouts
+    helpMenu->addAction(tr("Layout &Cache..."), [] {
+        bool ok;
+        const int megabytes = QInputDialog::getInt(
+            activeWin(), AppInfo::name(),
+            tr("Megabytes of block layouts to cache per editor (0 for no limit):"),
+            Attr::get().layoutBudget, 0, 64 * 1024, 16, &ok);
+        if (ok) {
+            MainWindow::setLayoutBudget(megabytes);
+        }
+    });
+
+    // Select from which size files open in the large file view
+    helpMenu->addAction(tr("Large &Files..."), [] {
+        bool ok;
+        const int megabytes = QInputDialog::getInt(
+            activeWin(), AppInfo::name(),
+            tr("Megabytes from which files open in the large file view "
+               "(0 to always use the editor):"),
+            Attr::get().largeFileSize, 0, 1024 * 1024, 64, &ok);
+        if (ok) {
+            Attr::get().largeFileSize = megabytes;
+            Attr::get().changed();
+        }
+    });
+
+    // Display how the current document uses memory
+    diagnosticsAction = helpMenu->addAction(tr("&Diagnostics..."), [] {
+        if (largeWin()) {
+            return;
+        }
+        auto dialog = new DiagnosticsDialog(win());
+        dialog->show();
+    });
+
+    helpMenu->addSeparator();
+
+    // Display program information
+    helpMenu->addAction(tr("&About"), QKeySequence("F1"), [] {
+        auto dialog = new AboutDialog(activeWin());
+        dialog->show();
+    });
+}
+
+void MenuBar::makeLangMenu() {
+    // Only fill the menu once
+    if (!langMenu->isEmpty()) {
+        return;
+    }
+
     auto langGroup = new QActionGroup(langMenu);
     langGroup->setExclusive(true);
-    connect(langGroup, &QActionGroup::triggered, this, [this] (QAction *action) {
+    connect(langGroup, &QActionGroup::triggered, langGroup, [] (QAction *action) {
         if (action->text() == LangUtil::getLangName(Attr::get().lang)) {
             return;
         }
@@ -249,11 +521,12 @@ void MenuBar::makeHelpMenu() {
         for (auto lang : LangUtil::getLanguages()) {
             if (LangUtil::getLangName(lang) == action->text()) {
                 Attr::get().lang = lang;
+                Attr::get().changed();
                 break;
             }
         }
 
-        QMessageBox::information(this, AppInfo::name(),
+        QMessageBox::information(activeWin(), AppInfo::name(),
                                  tr("For the new language to take effect, "
                                     "please relaunch the program."));
     });
@@ -264,12 +537,4 @@ void MenuBar::makeHelpMenu() {
         action->setChecked(Attr::get().lang == lang);
         langGroup->addAction(action);
     }
-
-    helpMenu->addSeparator();
-
-    // Display program information
-    helpMenu->addAction(tr("&About"), QKeySequence("F1"), [this] {
-        auto dialog = new AboutDialog(win);
-        dialog->show();
-    });
 }
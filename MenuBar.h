@@ -5,10 +5,13 @@
 
 // Forward declarations
 class MainWindow;
+class LargeWindow;
 class Editor;
 
 /**
  * @brief Displays menus and actions.
+ * @note The menus are built once and shared by the menu bars of all
+ * windows, text and large alike. Their actions apply to the active window.
  */
 class MenuBar : public QMenuBar {
     Q_OBJECT
@@ -16,63 +19,109 @@ class MenuBar : public QMenuBar {
 public:
     /**
      * @brief Initializes a new 'MenuBar' instance.
-     * @param win The parent 'MainWindow' instance.
+     * @param win The parent window.
      */
-    MenuBar(MainWindow *win);
+    MenuBar(QMainWindow *win);
+
+private:
+    // Shared menus
+    static QMenu *fileMenu;
+    static QMenu *editMenu;
+    static QMenu *viewMenu;
+    static QMenu *helpMenu;
+
+    // File menu actions
+    static QMenu *recentMenu;
+    static QAction *historyAction;
+
+    // Edit menu actions
+    static QAction *undoAction;
+    static QAction *redoAction;
+    static QAction *cutAction;
+    static QAction *copyAction;
+    static QAction *pasteAction;
+    static QAction *delAction;
+    static QAction *findAction;
+    static QAction *findPrevAction;
+    static QAction *findNextAction;
+    static QAction *replaceAction;
+    static QAction *goAction;
+
+    // View menu actions
+    static QAction *lineAction;
+    static QAction *statusAction;
+    static QAction *wrapAction;
+    static QAction *splitAction;
+
+    // Help menu actions
+    static QMenu *langMenu;
+    static QAction *residentAction;
+    static QAction *diagnosticsAction;
 
     /**
-     * @brief Adds a recent file path to the menu.
-     * @param path The path of a recently opened file.
+     * @brief Provides the window that the actions apply to.
+     * @return The active 'MainWindow' instance.
      */
-    void addRecent(const QString &path);
+    static MainWindow *win();
 
     /**
-     * @brief Clears all recent file paths from the menu.
+     * @brief Provides the editor that the actions apply to.
+     * @return The editor of the active window.
      */
-    void clearRecent();
-
-private:
-    MainWindow *win;
-    Editor *editor;
+    static Editor *editor();
 
-    // File menu actions
-    QMenu *recentMenu;
-    QAction *recentSep;
-    QAction *recentAction;
+    /**
+     * @brief Provides the large window that the actions apply to.
+     * @return The active 'LargeWindow' instance, or nullptr if the
+     * active window is not a large window.
+     */
+    static LargeWindow *largeWin();
 
-    // Edit menu actions
-    QAction *cutAction;
-    QAction *copyAction;
-    QAction *pasteAction;
-    QAction *delAction;
-    QAction *findPrevAction;
-    QAction *findNextAction;
-    QAction *goAction;
+    /**
+     * @brief Provides the window to parent dialogs to.
+     * @return The active window of either kind, or nullptr.
+     */
+    static QWidget *activeWin();
 
-    // View menu actions
-    QAction *lineAction;
-    QAction *statusAction;
-    QAction *wrapAction;
+    /**
+     * @brief Creates the shared menus once.
+     */
+    static void makeMenus();
 
     /**
      * @brief Creates a 'File' menu that contains
      * program actions and file operations.
      */
-    void makeFileMenu();
+    static void makeFileMenu();
+
+    /**
+     * @brief Fills the 'Open Recent' menu with the recent files.
+     */
+    static void updateRecentMenu();
 
     /**
      * @brief Creates an 'Edit' menu that contains editor actions.
      */
-    void makeEditMenu();
+    static void makeEditMenu();
+
+    /**
+     * @brief Enables the 'Edit' menu actions that apply to the active editor.
+     */
+    static void updateEditMenu();
 
     /**
      * @brief Creates an 'View' menu that contains view options.
      */
-    void makeViewMenu();
+    static void makeViewMenu();
 
     /**
      * @brief Creates an 'Help' menu that contains
      * preferences and program information.
      */
-    void makeHelpMenu();
+    static void makeHelpMenu();
+
+    /**
+     * @brief Fills the 'Language' menu on first use.
+     */
+    static void makeLangMenu();
 };
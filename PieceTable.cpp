@@ -0,0 +1,389 @@
+#include "PieceTable.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QSaveFile>
+#include <QThread>
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief A piece of text, and the tree of pieces around it.
+ */
+struct PieceTable::Node {
+    bool inAdded;       // Whether the piece is in the added buffer
+    qint64 start;       // Offset of the piece in its buffer
+    qint64 length;      // Length of the piece
+    qint64 breaks;      // Line breaks in the piece
+    quint32 priority;   // Random priority that keeps the tree balanced
+
+    Snapshot left;
+    Snapshot right;
+    qint64 totalLength; // Length of the pieces in this subtree
+    qint64 totalBreaks; // Line breaks in the pieces in this subtree
+};
+
+using Snapshot = PieceTable::Snapshot;
+
+/**
+ * @brief Provides the length of a subtree.
+ */
+static qint64 totalLength(const Snapshot &tree) {
+    return tree ? tree->totalLength : 0;
+}
+
+/**
+ * @brief Provides the number of line breaks in a subtree.
+ */
+static qint64 totalBreaks(const Snapshot &tree) {
+    return tree ? tree->totalBreaks : 0;
+}
+
+/**
+ * @brief Copies a node with other children.
+ * @param node The node whose piece and priority are kept.
+ * @param left The new left child.
+ * @param right The new right child.
+ * @return The new node.
+ */
+static Snapshot join(const PieceTable::Node &node, const Snapshot &left, const Snapshot &right) {
+    return std::make_shared<const PieceTable::Node>(PieceTable::Node{
+        node.inAdded, node.start, node.length, node.breaks, node.priority, left, right,
+        totalLength(left) + node.length + totalLength(right),
+        totalBreaks(left) + node.breaks + totalBreaks(right)
+    });
+}
+
+/**
+ * @brief Concatenates two trees, sharing every untouched node.
+ * @param a The tree of the text that comes first.
+ * @param b The tree of the text that comes next.
+ * @return The combined tree.
+ */
+static Snapshot merge(const Snapshot &a, const Snapshot &b) {
+    if (!a) {
+        return b;
+    }
+    if (!b) {
+        return a;
+    }
+    if (a->priority > b->priority) {
+        return join(*a, a->left, merge(a->right, b));
+    }
+    return join(*b, merge(a, b->left), b->right);
+}
+
+/**
+ * @brief Calls a function on each piece that overlaps a range, in order.
+ * @param tree The tree to visit.
+ * @param offset The byte offset of the range, relative to the tree.
+ * @param length The length of the range.
+ * @param visit Receives each node and the part of its piece in the range.
+ */
+template <typename Visit>
+static void visitRange(const Snapshot &tree, qint64 offset, qint64 length, const Visit &visit) {
+    if (!tree || length <= 0 || offset >= tree->totalLength || offset + length <= 0) {
+        return;
+    }
+
+    const qint64 leftLength = totalLength(tree->left);
+    visitRange(tree->left, offset, length, visit);
+
+    const qint64 from = qMax<qint64>(offset, leftLength);
+    const qint64 to = qMin(offset + length, leftLength + tree->length);
+    if (from < to) {
+        visit(*tree, from - leftLength, to - from);
+    }
+
+    const qint64 rightStart = leftLength + tree->length;
+    visitRange(tree->right, offset - rightStart, length, visit);
+}
+
+PieceTable::~PieceTable() {
+    // Release the pieces first, as they point into the mapping
+    root.reset();
+    unmap();
+}
+
+bool PieceTable::map(const QString &path) {
+    file.setFileName(path);
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    originalSize = file.size();
+    if (originalSize > 0) {
+        original = reinterpret_cast<const char *>(file.map(0, originalSize));
+        if (!original) {
+            originalSize = 0;
+            file.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void PieceTable::unmap() {
+    if (original) {
+        file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(original)));
+        original = nullptr;
+    }
+    file.close();
+}
+
+bool PieceTable::isIntact() const {
+    return file.isOpen() && QFileInfo{file.fileName()}.size() >= originalSize;
+}
+
+bool PieceTable::open(const QString &path) {
+    if (!map(path)) {
+        return false;
+    }
+
+    // Count the line breaks once per span, so that a line lookup only
+    // reads the span it falls in
+    originalBreaks.clear();
+    originalBreaks.reserve(originalSize / INDEX_SPAN + 1);
+    qint64 breaks = 0;
+    for (qint64 span = 0; span < originalSize; span += INDEX_SPAN) {
+        originalBreaks.append(breaks);
+        const char *from = original + span;
+        breaks += std::count(from, from + qMin(INDEX_SPAN, originalSize - span), '\n');
+    }
+    originalBreaks.append(breaks);
+
+    root = makePiece(false, 0, originalSize);
+
+    // The mapping is released by the GUI thread that uses the table
+    file.moveToThread(QCoreApplication::instance()->thread());
+    return true;
+}
+
+bool PieceTable::save(const QString &path) {
+    QSaveFile out{path};
+    if (!out.open(QSaveFile::WriteOnly)) {
+        return false;
+    }
+
+    // Write the pieces straight from their buffers, without joining them
+    bool ok = true;
+    visitRange(root, 0, size(), [this, &out, &ok] (const Node &node, qint64 from, qint64 count) {
+        ok = ok && out.write(buffer(node.inAdded) + node.start + from, count) == count;
+    });
+    if (!ok) {
+        return false;
+    }
+
+    // A mapped file cannot be replaced on Windows, and elsewhere the old
+    // mapping would keep the replaced file alive, so release it first
+    const QString oldPath = file.fileName();
+    unmap();
+    if (!out.commit()) {
+        // The pieces only hold offsets, so they are valid again once the
+        // untouched file is mapped back
+        map(oldPath);
+        return false;
+    }
+
+    // Continue from the saved file, which holds the whole text
+    added.clear();
+    addedBreaks.clear();
+    return open(path);
+}
+
+qint64 PieceTable::size() const {
+    return totalLength(root);
+}
+
+qint64 PieceTable::lineCount() const {
+    return totalBreaks(root) + 1;
+}
+
+qint64 PieceTable::memoryUsage() const {
+    // The mapped pages belong to the file cache, so only the buffers count
+    return added.capacity() +
+           (originalBreaks.capacity() + addedBreaks.capacity()) * sizeof(qint64);
+}
+
+qint64 PieceTable::lineStart(qint64 line) const {
+    if (line <= 0) {
+        return 0;
+    }
+    if (line >= lineCount()) {
+        return size();
+    }
+
+    // Find the piece with the line break that ends the previous line
+    qint64 remaining = line;
+    qint64 offset = 0;
+    const Node *node = root.get();
+    while (node) {
+        const qint64 leftBreaks = totalBreaks(node->left);
+        if (remaining <= leftBreaks) {
+            node = node->left.get();
+            continue;
+        }
+
+        remaining -= leftBreaks;
+        offset += totalLength(node->left);
+        if (remaining <= node->breaks) {
+            const qint64 index = breaksBefore(node->inAdded, node->start) + remaining - 1;
+            return offset + findBreak(node->inAdded, index) - node->start + 1;
+        }
+
+        remaining -= node->breaks;
+        offset += node->length;
+        node = node->right.get();
+    }
+    return size();
+}
+
+qint64 PieceTable::lineEnd(qint64 line) const {
+    return line + 1 < lineCount() ? lineStart(line + 1) - 1 : size();
+}
+
+qint64 PieceTable::lineAt(qint64 offset) const {
+    // Count the line breaks before the offset
+    qint64 line = 0;
+    const Node *node = root.get();
+    while (node && offset > 0) {
+        const qint64 leftLength = totalLength(node->left);
+        if (offset <= leftLength) {
+            node = node->left.get();
+            continue;
+        }
+
+        line += totalBreaks(node->left);
+        offset -= leftLength;
+        if (offset <= node->length) {
+            return line + countBreaks(node->inAdded, node->start, offset);
+        }
+
+        line += node->breaks;
+        offset -= node->length;
+        node = node->right.get();
+    }
+    return line;
+}
+
+QByteArray PieceTable::read(qint64 offset, qint64 length) const {
+    QByteArray bytes;
+    bytes.reserve(qMax<qint64>(0, qMin(length, size() - offset)));
+    visitRange(root, offset, length, [this, &bytes] (const Node &node, qint64 from, qint64 count) {
+        bytes.append(buffer(node.inAdded) + node.start + from, count);
+    });
+    return bytes;
+}
+
+void PieceTable::insert(qint64 offset, const QByteArray &bytes) {
+    if (bytes.isEmpty()) {
+        return;
+    }
+
+    // The added buffer only grows, so earlier snapshots stay valid
+    const qint64 start = added.size();
+    added.append(bytes);
+    for (qsizetype i = bytes.indexOf('\n'); i >= 0; i = bytes.indexOf('\n', i + 1)) {
+        addedBreaks.append(start + i);
+    }
+
+    const auto [before, after] = split(root, qBound<qint64>(0, offset, size()));
+    root = merge(merge(before, makePiece(true, start, bytes.size())), after);
+}
+
+void PieceTable::remove(qint64 offset, qint64 length) {
+    if (length <= 0) {
+        return;
+    }
+
+    const auto [before, rest] = split(root, offset);
+    root = merge(before, split(rest, length).second);
+}
+
+PieceTable::Snapshot PieceTable::snapshot() const {
+    return root;
+}
+
+void PieceTable::restore(const Snapshot &snapshot) {
+    root = snapshot;
+}
+
+const char *PieceTable::buffer(bool inAdded) const {
+    return inAdded ? added.constData() : original;
+}
+
+qint64 PieceTable::breaksBefore(bool inAdded, qint64 pos) const {
+    if (inAdded) {
+        return std::lower_bound(addedBreaks.cbegin(), addedBreaks.cend(), pos) -
+               addedBreaks.cbegin();
+    }
+
+    // Count from the start of the span
+    const qint64 span = pos / INDEX_SPAN;
+    const char *from = original + span * INDEX_SPAN;
+    return originalBreaks[span] + std::count(from, original + pos, '\n');
+}
+
+qint64 PieceTable::findBreak(bool inAdded, qint64 index) const {
+    if (inAdded) {
+        return addedBreaks[index];
+    }
+
+    // Find the span that holds the line break, then search it
+    const auto next = std::upper_bound(originalBreaks.cbegin(), originalBreaks.cend(), index);
+    const qint64 span = next - originalBreaks.cbegin() - 1;
+    qint64 remaining = index - originalBreaks[span];
+    const char *end = original + originalSize;
+    for (const char *pos = original + span * INDEX_SPAN; pos < end; ++pos) {
+        pos = static_cast<const char *>(std::memchr(pos, '\n', end - pos));
+        if (!pos) {
+            break;
+        }
+        if (remaining-- == 0) {
+            return pos - original;
+        }
+    }
+    return originalSize;
+}
+
+PieceTable::Snapshot PieceTable::makePiece(bool inAdded, qint64 start, qint64 length) const {
+    if (length <= 0) {
+        return nullptr;
+    }
+
+    const qint64 breaks = countBreaks(inAdded, start, length);
+    return std::make_shared<const Node>(Node{
+        inAdded, start, length, breaks, QRandomGenerator::global()->generate(),
+        nullptr, nullptr, length, breaks
+    });
+}
+
+qint64 PieceTable::countBreaks(bool inAdded, qint64 start, qint64 length) const {
+    return breaksBefore(inAdded, start + length) - breaksBefore(inAdded, start);
+}
+
+std::pair<Snapshot, Snapshot> PieceTable::split(const Snapshot &tree, qint64 offset) const {
+    if (!tree) {
+        return {};
+    }
+
+    const qint64 leftLength = totalLength(tree->left);
+    if (offset <= leftLength) {
+        const auto [before, after] = split(tree->left, offset);
+        return {before, join(*tree, after, tree->right)};
+    }
+
+    const qint64 pieceEnd = leftLength + tree->length;
+    if (offset >= pieceEnd) {
+        const auto [before, after] = split(tree->right, offset - pieceEnd);
+        return {join(*tree, tree->left, before), after};
+    }
+
+    // The offset falls inside this piece, which is cut in two
+    const qint64 cut = offset - leftLength;
+    const Snapshot &head = makePiece(tree->inAdded, tree->start, cut);
+    const Snapshot &tail = makePiece(tree->inAdded, tree->start + cut, tree->length - cut);
+    return {merge(tree->left, head), merge(tail, tree->right)};
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+
+#include <memory>
+#include <utility>
+
+/**
+ * @brief Stores UTF-8 text as pieces of a memory-mapped original file and
+ * an append-only buffer of added text.
+ * @note The pieces are kept in a balanced tree that is never modified in
+ * place, so offset and line lookups take O(log n) and a snapshot of the
+ * whole text is a single pointer.
+ */
+class PieceTable {
+public:
+    // Forward declarations
+    struct Node;
+
+    /// An unchangeable state of the text, for undo and redo.
+    using Snapshot = std::shared_ptr<const Node>;
+
+    /**
+     * @brief Initializes a new, empty 'PieceTable' instance.
+     */
+    PieceTable() = default;
+    ~PieceTable();
+
+    PieceTable(const PieceTable &) = delete;
+    PieceTable &operator=(const PieceTable &) = delete;
+
+    /**
+     * @brief Maps a file into memory as the original text.
+     * @note This reads the whole file to index its line breaks, so it may
+     * be called on a worker thread before the table is handed to the GUI.
+     * @param path The file path.
+     * @return true if the file is available; false otherwise.
+     */
+    bool open(const QString &path);
+
+    /**
+     * @brief Writes the text to a file, piece by piece, and continues
+     * from the saved file as the original text.
+     * @note Earlier snapshots point into the previous file, so they
+     * must not be restored after a save.
+     * @param path The file path.
+     * @return true if the file is saved; false otherwise.
+     */
+    bool save(const QString &path);
+
+    /**
+     * @brief Checks whether the mapped file can still be read.
+     * @note Reading the pages of a file truncated by another program
+     * crashes, so check this before reading once the file may have changed.
+     * @return true if the file is mapped and not shorter than when it was
+     * mapped; false otherwise.
+     */
+    bool isIntact() const;
+
+    /**
+     * @brief Provides the length of the text.
+     * @return The number of bytes.
+     */
+    qint64 size() const;
+
+    /**
+     * @brief Provides the number of lines, counting an empty last line.
+     * @return The number of lines.
+     */
+    qint64 lineCount() const;
+
+    /**
+     * @brief Estimates the memory used besides the mapped file.
+     * @return The number of bytes of the added text and line indexes.
+     */
+    qint64 memoryUsage() const;
+
+    /**
+     * @brief Provides the offset where a line starts.
+     * @param line The line, starting from 0.
+     * @return The byte offset of the first character of the line.
+     */
+    qint64 lineStart(qint64 line) const;
+
+    /**
+     * @brief Provides the offset where a line ends.
+     * @param line The line, starting from 0.
+     * @return The byte offset of the line break, or the text size.
+     */
+    qint64 lineEnd(qint64 line) const;
+
+    /**
+     * @brief Finds the line that contains an offset.
+     * @param offset The byte offset.
+     * @return The line, starting from 0.
+     */
+    qint64 lineAt(qint64 offset) const;
+
+    /**
+     * @brief Reads part of the text.
+     * @param offset The byte offset of the first byte.
+     * @param length The number of bytes.
+     * @return The bytes, which are fewer at the end of the text.
+     */
+    QByteArray read(qint64 offset, qint64 length) const;
+
+    /**
+     * @brief Inserts text.
+     * @param offset The byte offset to insert at.
+     * @param bytes The UTF-8 text.
+     */
+    void insert(qint64 offset, const QByteArray &bytes);
+
+    /**
+     * @brief Removes part of the text.
+     * @param offset The byte offset of the first byte.
+     * @param length The number of bytes.
+     */
+    void remove(qint64 offset, qint64 length);
+
+    /**
+     * @brief Provides the current state of the text.
+     * @return The snapshot, which costs no copy of the text.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Returns to an earlier state of the text.
+     * @param snapshot A snapshot taken from this table.
+     */
+    void restore(const Snapshot &snapshot);
+
+private:
+    QFile file;
+    const char *original{nullptr};  // The mapped file content
+    qint64 originalSize{0};
+    QByteArray added;               // Text inserted since the file was opened
+
+    /// Bytes of the original text per entry of its line break index.
+    static constexpr qint64 INDEX_SPAN = 16 * 1024;
+
+    // Line breaks before each span of the original text, so the index
+    // stays small for files with many short lines
+    QList<qint64> originalBreaks;
+    // Offsets of the line breaks in the added buffer
+    QList<qint64> addedBreaks;
+
+    Snapshot root;
+
+    /**
+     * @brief Maps a file into memory, without indexing it.
+     * @param path The file path.
+     * @return true if the file is mapped; false otherwise.
+     */
+    bool map(const QString &path);
+
+    /**
+     * @brief Releases the mapped file.
+     */
+    void unmap();
+
+    /**
+     * @brief Provides the start of a buffer.
+     * @param inAdded Whether to use the added buffer.
+     * @return The buffer content.
+     */
+    const char *buffer(bool inAdded) const;
+
+    /**
+     * @brief Counts the line breaks before an offset of a buffer.
+     * @param inAdded Whether to use the added buffer.
+     * @param pos The offset in the buffer.
+     * @return The number of line breaks.
+     */
+    qint64 breaksBefore(bool inAdded, qint64 pos) const;
+
+    /**
+     * @brief Finds a line break in a buffer.
+     * @param inAdded Whether to use the added buffer.
+     * @param index The index of the line break, starting from 0.
+     * @return The offset of the line break in the buffer.
+     */
+    qint64 findBreak(bool inAdded, qint64 index) const;
+
+    /**
+     * @brief Creates a leaf for a range of a buffer.
+     * @param inAdded Whether the range is in the added buffer.
+     * @param start The offset of the range in the buffer.
+     * @param length The length of the range.
+     * @return The new node.
+     */
+    Snapshot makePiece(bool inAdded, qint64 start, qint64 length) const;
+
+    /**
+     * @brief Counts the line breaks in a range of a buffer.
+     * @param inAdded Whether the range is in the added buffer.
+     * @param start The offset of the range in the buffer.
+     * @param length The length of the range.
+     * @return The number of line breaks.
+     */
+    qint64 countBreaks(bool inAdded, qint64 start, qint64 length) const;
+
+    /**
+     * @brief Splits a tree at an offset, sharing every untouched node.
+     * @param tree The tree to split.
+     * @param offset The byte offset to split at.
+     * @return The trees of the text before and after the offset.
+     */
+    std::pair<Snapshot, Snapshot> split(const Snapshot &tree, qint64 offset) const;
+};
@@ -14,12 +14,24 @@ SOURCES += \
     Dialog.cpp \
     Editor.cpp \
     FileUtil.cpp \
+    HexWindow.cpp \
+    History.cpp \
     IconUtil.cpp \
+    IpcUtil.cpp \
+    Journal.cpp \
+    LargeWindow.cpp \
+    Loader.cpp \
     Lang.cpp \
     Main.cpp \
     MainWindow.cpp \
     MenuBar.cpp \
-    StatusBar.cpp
+    PieceTable.cpp \
+    RecentFiles.cpp \
+    Resident.cpp \
+    Session.cpp \
+    Startup.cpp \
+    StatusBar.cpp \
+    UndoStore.cpp
 
 HEADERS += \
     AppInfo.h \
@@ -27,11 +39,23 @@ HEADERS += \
     Dialog.h \
     Editor.h \
     FileUtil.h \
+    HexWindow.h \
+    History.h \
     IconUtil.h \
+    IpcUtil.h \
+    Journal.h \
+    LargeWindow.h \
+    Loader.h \
     Lang.h \
     MainWindow.h \
     MenuBar.h \
-    StatusBar.h
+    PieceTable.h \
+    RecentFiles.h \
+    Resident.h \
+    Session.h \
+    Startup.h \
+    StatusBar.h \
+    UndoStore.h
 
 include(SingleApplication-3.5.2/singleapplication.pri)
 DEFINES += QAPPLICATION_CLASS=QApplication
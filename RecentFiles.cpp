@@ -0,0 +1,94 @@
+#include "RecentFiles.h"
+#include "MainWindow.h"
+#include "Attr.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QThreadPool>
+
+QSet<QString> RecentFiles::index;
+bool RecentFiles::indexed = false;
+bool RecentFiles::validating = false;
+
+void RecentFiles::add(const QString &path) {
+    ensureIndex();
+
+    const QString &fullPath = QFileInfo{path}.absoluteFilePath();
+    auto &paths = Attr::get().recentPaths;
+
+    // Move the file to the front; the list is short, so removing is cheap
+    if (index.contains(fullPath)) {
+        if (paths.constFirst() == fullPath) {
+            return;
+        }
+        paths.removeOne(fullPath);
+    } else {
+        index.insert(fullPath);
+    }
+    paths.prepend(fullPath);
+
+    // Forget the least recently opened file
+    if (paths.size() > MAX_COUNT) {
+        index.remove(paths.takeLast());
+    }
+    Attr::get().changed();
+}
+
+void RecentFiles::clear() {
+    Attr::get().recentPaths.clear();
+    index.clear();
+    indexed = true;
+    Attr::get().changed();
+}
+
+const QStringList &RecentFiles::paths() {
+    ensureIndex();
+    return Attr::get().recentPaths;
+}
+
+void RecentFiles::ensureIndex() {
+    if (indexed) {
+        return;
+    }
+    indexed = true;
+
+    // Drop duplicates and files beyond the limit from older settings
+    auto &paths = Attr::get().recentPaths;
+    QStringList kept;
+    for (const auto &path : std::as_const(paths)) {
+        if (kept.size() < MAX_COUNT && !index.contains(path)) {
+            index.insert(path);
+            kept.append(path);
+        }
+    }
+    paths = kept;
+}
+
+void RecentFiles::validate() {
+    if (validating || Attr::get().recentPaths.isEmpty()) {
+        return;
+    }
+    validating = true;
+
+    // Checking a path may block on a slow or disconnected drive
+    const QStringList paths{Attr::get().recentPaths};
+    QThreadPool::globalInstance()->start([paths] {
+        QStringList missing;
+        for (const auto &path : paths) {
+            if (!QFileInfo::exists(path)) {
+                missing.append(path);
+            }
+        }
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [missing] {
+            validating = false;
+            for (const auto &path : missing) {
+                index.remove(path);
+                Attr::get().recentPaths.removeOne(path);
+            }
+            if (!missing.isEmpty()) {
+                Attr::get().changed();
+            }
+        });
+    });
+}
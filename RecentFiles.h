@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QSet>
+#include <QStringList>
+
+/**
+ * @brief Keeps the recently opened files, shared by all windows.
+ * @note The most recent file is moved to the front and the oldest files
+ * are dropped beyond the limit. Menus are only filled when they are shown.
+ */
+class RecentFiles {
+public:
+    /// Maximum number of recent files kept.
+    static constexpr qsizetype MAX_COUNT = 20;
+
+    /**
+     * @brief Marks a file as the most recently opened one.
+     * @param path The file path.
+     */
+    static void add(const QString &path);
+
+    /**
+     * @brief Forgets all recent files.
+     */
+    static void clear();
+
+    /**
+     * @brief Provides the recent files.
+     * @return The full file paths, the most recent first.
+     */
+    static const QStringList &paths();
+
+    /**
+     * @brief Removes recent files that no longer exist,
+     * checking them on another thread.
+     */
+    static void validate();
+
+private:
+    RecentFiles() = delete;     // Prevent instantiation
+
+    // Paths of the recent files, for lookup without a linear search
+    static QSet<QString> index;
+    static bool indexed;
+    static bool validating;
+
+    /**
+     * @brief Builds the lookup index from the saved paths once.
+     */
+    static void ensureIndex();
+};
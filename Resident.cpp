@@ -0,0 +1,84 @@
+#include "Resident.h"
+#include "MainWindow.h"
+#include "Attr.h"
+
+#include <QApplication>
+#include <QPixmapCache>
+#include <QTimer>
+
+#include <chrono>
+
+#if defined(Q_OS_WINDOWS)
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+QTimer *Resident::themeTimer = nullptr;
+QTimer *Resident::idleTimer = nullptr;
+
+void Resident::setup(QTimer *themeTimer) {
+    Resident::themeTimer = themeTimer;
+
+    // Quit once the program has been idle for too long
+    idleTimer = new QTimer{qApp};
+    idleTimer->setSingleShot(true);
+    QObject::connect(idleTimer, &QTimer::timeout, qApp, &QApplication::quit);
+
+    QObject::connect(qApp, &QApplication::lastWindowClosed, qApp, &Resident::sleep);
+    QApplication::setQuitOnLastWindowClosed(!Attr::get().resident);
+}
+
+void Resident::setEnabled(bool enabled) {
+    Attr::get().resident = enabled;
+    Attr::get().changed();
+    QApplication::setQuitOnLastWindowClosed(!enabled);
+}
+
+void Resident::setTimeout(int minutes) {
+    Attr::get().residentTimeout = qMax(0, minutes);
+    Attr::get().changed();
+}
+
+void Resident::wake() {
+    idleTimer->stop();
+
+    if (!themeTimer->isActive()) {
+        // The theme may have changed while idle
+        MainWindow::updateTheme();
+        themeTimer->start();
+    }
+}
+
+void Resident::sleep() {
+    if (!Attr::get().resident) {
+        return;
+    }
+
+    // Save the attributes now, in case the program is ended while idle
+    Attr::get().save();
+
+    // Stop polling, so that the idle program is never woken up
+    themeTimer->stop();
+
+    // The closed windows are only deleted once control returns to the
+    // event loop, so release their memory after that
+    QTimer::singleShot(0, qApp, &Resident::trim);
+
+    if (Attr::get().residentTimeout > 0) {
+        idleTimer->start(std::chrono::minutes{Attr::get().residentTimeout});
+    }
+}
+
+void Resident::trim() {
+    // Delete the windows still waiting for it, and whatever they delete later
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+
+    QPixmapCache::clear();
+#if defined(Q_OS_WINDOWS)
+    SetProcessWorkingSetSize(GetCurrentProcess(), SIZE_T(-1), SIZE_T(-1));
+#elif defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
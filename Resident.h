@@ -0,0 +1,56 @@
+#pragma once
+
+// Forward declarations
+class QTimer;
+
+/**
+ * @brief Keeps the primary instance running in the background after the
+ * last window closes, so the next launch only has to open a window.
+ * @note While idle, periodic work is stopped and caches are released,
+ * and the program quits after a configurable timeout.
+ */
+class Resident {
+public:
+    /**
+     * @brief Applies the saved resident mode and starts watching for the
+     * last window to close.
+     * @param themeTimer The timer that polls for theme changes,
+     * which is stopped while idle.
+     */
+    static void setup(QTimer *themeTimer);
+
+    /**
+     * @brief Enables or disables resident mode.
+     * @param enabled Whether to keep running after the last window closes.
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * @brief Sets how long to stay idle before quitting.
+     * @param minutes The timeout in minutes, or 0 to never quit.
+     */
+    static void setTimeout(int minutes);
+
+    /**
+     * @brief Resumes periodic work before a window is opened.
+     */
+    static void wake();
+
+private:
+    Resident() = delete;    // Prevent instantiation
+
+    static QTimer *themeTimer;
+    static QTimer *idleTimer;
+
+    /**
+     * @brief Releases memory and stops periodic work
+     * after the last window closes.
+     */
+    static void sleep();
+
+    /**
+     * @brief Hands the memory of the closed windows back to the system,
+     * once they are deleted.
+     */
+    static void trim();
+};
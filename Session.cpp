@@ -0,0 +1,133 @@
+#include "Session.h"
+#include "MainWindow.h"
+#include "Editor.h"
+#include "FileUtil.h"
+
+#include <QApplication>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+// Identifies a session file
+static constexpr quint32 SESSION_MAGIC = 0x514E5353;
+// Version of the session format
+static constexpr quint32 SESSION_VERSION = 1;
+
+/**
+ * @brief Describes a window of the session.
+ */
+struct SessionWindow {
+    QString path;
+    QString text;
+    qint32 line;
+    qint32 column;
+    qint32 scroll;
+    QByteArray geometry;
+};
+
+static QDataStream &operator<<(QDataStream &out, const SessionWindow &entry) {
+    return out << entry.path << entry.text << entry.line << entry.column
+               << entry.scroll << entry.geometry;
+}
+
+static QDataStream &operator>>(QDataStream &in, SessionWindow &entry) {
+    return in >> entry.path >> entry.text >> entry.line >> entry.column
+              >> entry.scroll >> entry.geometry;
+}
+
+void Session::record() {
+    const auto &windows = MainWindow::getWindows();
+    if (windows.isEmpty()) {
+        return;
+    }
+
+    QList<SessionWindow> entries;
+    qint32 active = -1;
+    for (const auto &win : windows) {
+        SessionWindow entry;
+        entry.path = win->getFilePath();
+        // Only untitled documents have no file to read the text from
+        if (entry.path.isEmpty()) {
+            entry.text = Editor::fileText(win->getEditor()->document());
+        }
+        int line, column, scroll;
+        win->getView(line, column, scroll);
+        entry.line = line;
+        entry.column = column;
+        entry.scroll = scroll;
+        entry.geometry = win->saveGeometry();
+
+        if (win->isActiveWindow()) {
+            active = entries.size();
+        }
+        entries.append(entry);
+    }
+
+    QSaveFile file{sessionPath()};
+    if (!file.open(QSaveFile::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out{&file};
+    out.setVersion(QDataStream::Qt_6_0);
+    out << SESSION_MAGIC << SESSION_VERSION << active << entries;
+    if (out.status() == QDataStream::Ok) {
+        file.commit();
+    }
+}
+
+bool Session::restore() {
+    QFile file{sessionPath()};
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in{&file};
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic, version;
+    qint32 active;
+    QList<SessionWindow> entries;
+    in >> magic >> version;
+    if (magic != SESSION_MAGIC || version != SESSION_VERSION) {
+        return false;
+    }
+    in >> active >> entries;
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    MainWindow *activeWin = nullptr;
+    MainWindow *lastWin = nullptr;
+    for (qsizetype i = 0; i < entries.size(); i++) {
+        const auto &entry = entries[i];
+        // Skip files that are gone, and untitled documents that were empty
+        if (entry.path.isEmpty() ? entry.text.isEmpty() : !QFile::exists(entry.path)) {
+            continue;
+        }
+
+        auto win = MainWindow::reopen(entry.path, entry.text,
+                                      entry.line, entry.column, entry.scroll);
+        win->restoreGeometry(entry.geometry);
+        lastWin = win;
+        if (i == active) {
+            activeWin = win;
+        }
+    }
+
+    // Bring the previously active window back to the front, and read its
+    // file right away; the other files are read once their windows are
+    // activated
+    if (!activeWin) {
+        activeWin = lastWin;
+    }
+    if (activeWin) {
+        activeWin->raise();
+        activeWin->activateWindow();
+        activeWin->loadNow();
+    }
+    return lastWin != nullptr;
+}
+
+QString Session::sessionPath() {
+    return FileUtil::dataDir("session") + "/session.dat";
+}
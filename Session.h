@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QString>
+
+/**
+ * @brief Saves the open windows on exit and brings them back on launch.
+ * @note Each window keeps its file, cursor, scroll position and geometry,
+ * and untitled documents keep their text. Only the active window reads its
+ * file right away; the others wait until they are activated, so a large
+ * session restores as fast as one window.
+ */
+class Session {
+public:
+    /**
+     * @brief Saves the open windows, replacing the previous session.
+     * @note Nothing is saved if no window is open.
+     */
+    static void record();
+
+    /**
+     * @brief Reopens the windows of the previous session.
+     * @return Whether any window was reopened.
+     */
+    static bool restore();
+
+private:
+    Session() = delete;     // Prevent instantiation
+
+    /**
+     * @brief Provides the path of the session file.
+     * @return The full file path.
+     */
+    static QString sessionPath();
+};
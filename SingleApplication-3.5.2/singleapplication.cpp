@@ -245,9 +245,10 @@ QString SingleApplication::currentUser() const
  * @param message The message to send.
  * @param timeout the maximum timeout in milliseconds for blocking functions.
  * @param sendMode mode of operation
+ * @param retries How many more times to wait for a late acknowledgement.
  * @return true if the message was sent successfuly, false otherwise.
  */
-bool SingleApplication::sendMessage( const QByteArray &message, int timeout, SendMode sendMode )
+bool SingleApplication::sendMessage( const QByteArray &message, int timeout, SendMode sendMode, int retries )
 {
     Q_D( SingleApplication );
 
@@ -258,7 +259,59 @@ bool SingleApplication::sendMessage( const QByteArray &message, int timeout, Sen
     if( ! d->connectToPrimary( timeout,  SingleApplicationPrivate::Reconnect ) )
       return false;
 
-    return d->writeConfirmedMessage( timeout, message, sendMode );
+    return d->writeConfirmedMessage( timeout, message, sendMode, retries );
+}
+
+/**
+ * Sends a message to the Primary Instance without constructing a
+ * SingleApplication. The server name only depends on the QCoreApplication
+ * properties, so no shared memory block or GUI is needed.
+ * @param message The message to send.
+ * @param options The options the primary instance was started with.
+ * @param timeout the maximum timeout in milliseconds for blocking functions.
+ * @param userData The user data the primary instance was started with.
+ * @return true if the message was sent successfuly, false otherwise.
+ */
+bool SingleApplication::sendToPrimary( const QByteArray &message, Options options, int timeout, const QString &userData )
+{
+    bool sent = false;
+    return sendToPrimary( [&message, &sent]( QByteArray &next ){
+        if( sent ) return false;
+        next = message;
+        sent = true;
+        return true;
+    }, options, timeout, 0, userData );
+}
+
+/**
+ * Sends a sequence of messages to the Primary Instance over one connection,
+ * without constructing a SingleApplication. Each message is only requested
+ * once the previous one has been acknowledged.
+ * @param nextMessage Writes the next message, or returns false when done.
+ * @param options The options the primary instance was started with.
+ * @param timeout the maximum timeout in milliseconds for blocking functions.
+ * @param retries How many more times to wait for a late acknowledgement.
+ * @param userData The user data the primary instance was started with.
+ * @return true if every message was sent successfuly, false otherwise.
+ */
+bool SingleApplication::sendToPrimary( const std::function<bool( QByteArray & )> &nextMessage, Options options, int timeout, int retries, const QString &userData )
+{
+    SingleApplicationPrivate d( nullptr );
+    d.options = options;
+    if ( ! userData.isEmpty() )
+        d.addAppData( userData );
+    d.genBlockServerName();
+
+    if( ! d.connectToPrimary( timeout, SingleApplicationPrivate::Reconnect ) )
+      return false;
+
+    QByteArray message;
+    while( nextMessage( message ) ){
+        if( ! d.writeConfirmedMessage( timeout, message, NonBlocking, retries ) )
+            return false;
+    }
+
+    return true;
 }
 
 /**
@@ -27,6 +27,8 @@
 #include <QtCore/QtGlobal>
 #include <QtNetwork/QLocalSocket>
 
+#include <functional>
+
 #ifndef QAPPLICATION_CLASS
   #define QAPPLICATION_CLASS QCoreApplication
 #endif
@@ -152,10 +154,44 @@ public:
      * @param message data to send
      * @param timeout timeout for connecting
      * @param sendMode - Mode of operation
+     * @param retries how many more times to wait for the acknowledgement
+     * while the primary instance is still connected
      * @returns `true` on success
      * @note sendMessage() will return false if invoked from the primary instance
      */
-    bool sendMessage( const QByteArray &message, int timeout = 100, SendMode sendMode = NonBlocking );
+    bool sendMessage( const QByteArray &message, int timeout = 100, SendMode sendMode = NonBlocking, int retries = 0 );
+
+    /**
+     * @brief Sends a message to a running primary instance without
+     * constructing a SingleApplication
+     * @param message data to send
+     * @param options must match the options of the primary instance
+     * @param timeout timeout for connecting and sending
+     * @param userData must match the user data of the primary instance
+     * @returns `true` if a primary instance received the message
+     * @note Only a QCoreApplication needs to exist, so a launcher can forward
+     * its arguments without initialising the GUI. If this returns false,
+     * construct a SingleApplication as usual.
+     */
+    static bool sendToPrimary( const QByteArray &message, Options options = Mode::User, int timeout = 100, const QString &userData = {} );
+
+    /**
+     * @brief Sends a sequence of messages to a running primary instance
+     * over a single connection, without constructing a SingleApplication
+     * @param nextMessage writes the next message and returns `true`, or
+     * returns `false` when there are no more messages
+     * @param options must match the options of the primary instance
+     * @param timeout timeout for connecting and for sending each message
+     * @param retries how many more times to wait for the acknowledgement of
+     * a message while the primary instance is still connected
+     * @param userData must match the user data of the primary instance
+     * @returns `true` if a primary instance received every message
+     * @note The next message is only requested once the previous one has
+     * been received, so at most one message is in flight. A message is never
+     * sent twice, as a late acknowledgement only means the primary instance
+     * is busy.
+     */
+    static bool sendToPrimary( const std::function<bool( QByteArray & )> &nextMessage, Options options = Mode::User, int timeout = 100, int retries = 0, const QString &userData = {} );
 
     /**
      * @brief Get the set user data.
@@ -175,6 +211,12 @@ Q_SIGNALS:
      */
     void receivedMessage( quint32 instanceId, QByteArray message );
 
+    /**
+     * @brief Triggered whenever the connection of a secondary instance closes
+     * @param lastMessage the last message received over the connection
+     */
+    void connectionClosed( quint32 instanceId, QByteArray lastMessage );
+
 private:
     SingleApplicationPrivate *d_ptr;
     Q_DECLARE_PRIVATE(SingleApplication)
@@ -244,24 +244,30 @@ bool SingleApplicationPrivate::connectToPrimary( int msecs, ConnectionType conne
 
     if( socket->state() == QLocalSocket::ConnectedState ) return true;
 
-    if( socket->state() != QLocalSocket::ConnectedState ){
-
-        while( true ){
-            randomSleep();
-
-          if( socket->state() != QLocalSocket::ConnectingState )
-            socket->connectToServer( blockServerName );
+    // The primary instance marks itself as primary in the memory block
+    // before it listens, so an instance that found it there tries again
+    // until it answers. Without a memory block, as when forwarding a
+    // launch, a missing server or a socket left behind by a primary
+    // instance that has exited means there is nobody to wait for; the
+    // caller then constructs a SingleApplication, which checks the block.
+    while( socket->state() != QLocalSocket::ConnectedState ){
+        socket->connectToServer( blockServerName );
+
+        if( socket->state() == QLocalSocket::ConnectingState ){
+            socket->waitForConnected( static_cast<int>(msecs - time.elapsed()) );
+        }
 
-          if( socket->state() == QLocalSocket::ConnectingState ){
-              socket->waitForConnected( static_cast<int>(msecs - time.elapsed()) );
-          }
+        // If connected break out of the loop
+        if( socket->state() == QLocalSocket::ConnectedState ) break;
 
-          // If connected break out of the loop
-          if( socket->state() == QLocalSocket::ConnectedState ) break;
+        // If there is no server, or the method timeout has elapsed, return
+        if( memory == nullptr &&
+            ( socket->error() == QLocalSocket::ServerNotFoundError ||
+              socket->error() == QLocalSocket::ConnectionRefusedError )) return false;
+        if( time.elapsed() >= msecs ) return false;
 
-          // If elapsed time since start is longer than the method timeout return
-          if( time.elapsed() >= msecs ) return false;
-        }
+        socket->abort();
+        QThread::msleep( 1 );
     }
 
     // Initialisation message according to the SingleApplication protocol
@@ -289,7 +295,7 @@ void SingleApplicationPrivate::writeAck( QLocalSocket *sock ) {
     sock->putChar('\n');
 }
 
-bool SingleApplicationPrivate::writeConfirmedMessage (int msecs, const QByteArray &msg, SingleApplication::SendMode sendMode)
+bool SingleApplicationPrivate::writeConfirmedMessage (int msecs, const QByteArray &msg, SingleApplication::SendMode sendMode, int retries)
 {
     QElapsedTimer time;
     time.start();
@@ -303,11 +309,12 @@ bool SingleApplicationPrivate::writeConfirmedMessage (int msecs, const QByteArra
 #endif
     headerStream << static_cast <quint64>( msg.length() );
 
-    if( ! writeConfirmedFrame( static_cast<int>(msecs - time.elapsed()), header ))
+    // Frames that may be retried get the full timeout for every attempt
+    if( ! writeConfirmedFrame( retries > 0 ? msecs : static_cast<int>(msecs - time.elapsed()), header, retries ))
         return false;
 
     // Frame 2: The message
-    const bool result = writeConfirmedFrame( static_cast<int>(msecs - time.elapsed()), msg );
+    const bool result = writeConfirmedFrame( retries > 0 ? msecs : static_cast<int>(msecs - time.elapsed()), msg, retries );
 
     // Block if needed
     if (socket && sendMode == SingleApplication::BlockUntilPrimaryExit)
@@ -316,18 +323,20 @@ bool SingleApplicationPrivate::writeConfirmedMessage (int msecs, const QByteArra
     return result;
 }
 
-bool SingleApplicationPrivate::writeConfirmedFrame( int msecs, const QByteArray &msg )
+bool SingleApplicationPrivate::writeConfirmedFrame( int msecs, const QByteArray &msg, int retries )
 {
     socket->write( msg );
     socket->flush();
 
-    bool result = socket->waitForReadyRead( msecs ); // await ack byte
-    if (result) {
-        socket->read( 1 );
-        return true;
+    // await ack byte; the frame has already been written, so a late ack is
+    // waited for again rather than sending the frame twice
+    while( ! socket->waitForReadyRead( msecs ) ){
+        if( retries-- <= 0 || socket->state() != QLocalSocket::ConnectedState )
+            return false;
     }
 
-    return false;
+    socket->read( 1 );
+    return true;
 }
 
 quint16 SingleApplicationPrivate::blockChecksum() const
@@ -525,14 +534,19 @@ void SingleApplicationPrivate::slotDataAvailable( QLocalSocket *dataSocket, quin
 
     ConnectionInfo &info = connectionMap[dataSocket];
     info.stage = StageConnectedHeader;
+    info.lastMessage = message;
 
     Q_EMIT q->receivedMessage( instanceId, message);
 }
 
 void SingleApplicationPrivate::slotClientConnectionClosed( QLocalSocket *closedSocket, quint32 instanceId )
 {
+    Q_Q(SingleApplication);
+
     if( closedSocket->bytesAvailable() > 0 )
         slotDataAvailable( closedSocket, instanceId  );
+
+    Q_EMIT q->connectionClosed( instanceId, connectionMap.value( closedSocket ).lastMessage );
 }
 
 void SingleApplicationPrivate::randomSleep()
@@ -50,6 +50,7 @@ struct ConnectionInfo {
     qint64 msgLen = 0;
     quint32 instanceId = 0;
     quint8 stage = 0;
+    QByteArray lastMessage;
 };
 
 class SingleApplicationPrivate : public QObject {
@@ -85,8 +86,8 @@ public:
     void readMessageHeader(QLocalSocket *socket, ConnectionStage nextStage);
     void readInitMessageBody(QLocalSocket *socket);
     void writeAck(QLocalSocket *sock);
-    bool writeConfirmedFrame(int msecs, const QByteArray &msg);
-    bool writeConfirmedMessage(int msecs, const QByteArray &msg, SingleApplication::SendMode sendMode = SingleApplication::NonBlocking);
+    bool writeConfirmedFrame(int msecs, const QByteArray &msg, int retries = 0);
+    bool writeConfirmedMessage(int msecs, const QByteArray &msg, SingleApplication::SendMode sendMode = SingleApplication::NonBlocking, int retries = 0);
     static void randomSleep();
     void addAppData(const QString &data);
     QStringList appData() const;
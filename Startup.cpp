@@ -0,0 +1,185 @@
+#include "Startup.h"
+#include "MainWindow.h"
+#include "Attr.h"
+#include "FileUtil.h"
+
+#include <QApplication>
+#include <QFile>
+#include <QFontDatabase>
+#include <QLibraryInfo>
+#include <QTimer>
+#include <QTranslator>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+QElapsedTimer Startup::clock;
+qint64 Startup::lastMark = 0;
+QList<QPair<QString, qint64>> Startup::timings;
+bool Startup::finished = false;
+
+/**
+ * @brief Calls a function once any widget has been painted.
+ */
+class PaintWatcher : public QObject {
+public:
+    /**
+     * @brief Initializes a new 'PaintWatcher' instance.
+     * @param painted The function to call after the first paint.
+     */
+    PaintWatcher(const std::function<void()> &painted)
+        : QObject{qApp}, painted{painted} {}
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override {
+        if (event->type() == QEvent::Paint && painted) {
+            // Stop watching, then continue once the paint has finished
+            qApp->removeEventFilter(this);
+            QTimer::singleShot(0, qApp, std::exchange(painted, nullptr));
+            deleteLater();
+        }
+        return QObject::eventFilter(watched, event);
+    }
+
+private:
+    std::function<void()> painted;
+};
+
+/**
+ * @brief Installs the translations of the display language.
+ */
+static void loadTranslations() {
+    if (Attr::get().lang == Lang::ENGLISH) {
+        return;
+    }
+
+    const QString basePath{QLibraryInfo::path(QLibraryInfo::TranslationsPath)};
+    const QString code{LangUtil::getLangCode(Attr::get().lang)};
+
+    auto baseTrans = new QTranslator{qApp};
+    if (baseTrans->load("qtbase_" + code, basePath)) {
+        QApplication::installTranslator(baseTrans);
+    }
+    auto appTrans = new QTranslator{qApp};
+    if (appTrans->load(":/i18n/TTT_" + code)) {
+        QApplication::installTranslator(appTrans);
+    }
+}
+
+void Startup::begin() {
+    clock.start();
+    lastMark = 0;
+}
+
+void Startup::mark(const QString &stage) {
+    const qint64 now = clock.elapsed();
+    timings.append({stage, now - lastMark});
+    lastMark = now;
+}
+
+void Startup::defer() {
+    // Without a window on screen, there is no paint to wait for
+    const auto widgets = QApplication::topLevelWidgets();
+    const bool shown = std::any_of(widgets.cbegin(), widgets.cend(), [] (QWidget *widget) {
+        return widget->isVisible();
+    });
+    if (!shown) {
+        QTimer::singleShot(0, qApp, &Startup::runStages);
+        return;
+    }
+
+    qApp->installEventFilter(new PaintWatcher{[] {
+        mark("first paint");
+        runStages();
+    }});
+}
+
+bool Startup::isFinished() {
+    return finished;
+}
+
+void Startup::runStages() {
+    // Translations come first, as the menus are built with translated text
+    static const QList<QPair<QString, std::function<void()>>> stages{
+        {"translations", &loadTranslations},
+        {"menus", &MainWindow::makeMenuBars},
+        {"font", [] {
+            // For displaying monospaced characters
+            QFontDatabase::addApplicationFont(":/fonts/CascadiaCode.ttf");
+            MainWindow::updateEditorFont();
+        }},
+        {"stylesheet", [] {
+            qApp->setStyleSheet(FileUtil::readAll(":/conf/Styles.qss"));
+        }},
+    };
+    static qsizetype next = 0;
+
+    // Only count the time of the stage itself, not the idle time before it
+    lastMark = clock.elapsed();
+    const auto &[name, run] = stages[next];
+    run();
+    mark(name);
+
+    // Return to the event loop between stages, so that input and painting
+    // are handled in between
+    if (++next < stages.size()) {
+        QTimer::singleShot(0, qApp, &Startup::runStages);
+    } else {
+        finished = true;
+        report();
+        benchmark();
+    }
+}
+
+void Startup::report() {
+    if (!qEnvironmentVariableIsSet("QNOTEPAD_STARTUP_TRACE")) {
+        return;
+    }
+
+    for (const auto &[stage, msecs] : std::as_const(timings)) {
+        qInfo("startup: %-14s %6lld ms", qPrintable(stage), static_cast<long long>(msecs));
+    }
+    qInfo("startup: %-14s %6lld ms", "total", static_cast<long long>(clock.elapsed()));
+}
+
+/**
+ * @brief Reads the memory used by this process.
+ * @return The resident size in bytes, or 0 if it is unknown.
+ */
+static qint64 residentSize() {
+    // Only Linux reports it cheaply; elsewhere only the time is measured
+    QFile statm{"/proc/self/statm"};
+    if (!statm.open(QFile::ReadOnly)) {
+        return 0;
+    }
+    const QList<QByteArray> &fields = statm.readAll().split(' ');
+    return fields.size() > 1 ? fields[1].toLongLong() * 4096 : 0;
+}
+
+void Startup::benchmark() {
+    const int count = qEnvironmentVariableIntValue("QNOTEPAD_BENCH_WINDOWS");
+    if (count <= 0) {
+        return;
+    }
+
+    const qint64 memBefore = residentSize();
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count; i++) {
+        MainWindow::newWindow();
+    }
+    const qint64 msecs = timer.elapsed();
+    const qint64 memAfter = residentSize();
+
+    qInfo("bench: %d windows in %lld ms (%.2f ms each)", count,
+          static_cast<long long>(msecs), static_cast<double>(msecs) / count);
+    if (memBefore > 0) {
+        qInfo("bench: %lld KiB each", static_cast<long long>((memAfter - memBefore) / count / 1024));
+    }
+
+    // Quit without closing the windows, so the session is left untouched
+    QTimer::singleShot(0, qApp, [] {
+        QApplication::exit(0);
+    });
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+/**
+ * @brief Runs the startup in stages, so the first window and its text are
+ * on screen before the menus, translations, font and stylesheet are loaded.
+ * @note Each stage is timed. Set the 'QNOTEPAD_STARTUP_TRACE' environment
+ * variable to print the timings once the startup has finished.
+ * Set 'QNOTEPAD_BENCH_WINDOWS' to a number of windows to time opening them
+ * after the startup, print the result and quit.
+ */
+class Startup {
+public:
+    /**
+     * @brief Starts timing the startup.
+     */
+    static void begin();
+
+    /**
+     * @brief Records the time spent on a stage since the previous one.
+     * @param stage The name of the stage.
+     */
+    static void mark(const QString &stage);
+
+    /**
+     * @brief Runs the remaining stages in idle slices,
+     * once the first window has been painted.
+     */
+    static void defer();
+
+    /**
+     * @brief Checks whether every stage has finished.
+     * @return true if the startup has finished; false otherwise.
+     */
+    static bool isFinished();
+
+private:
+    Startup() = delete;     // Prevent instantiation
+
+    static QElapsedTimer clock;
+    static qint64 lastMark;
+    static QList<QPair<QString, qint64>> timings;
+    static bool finished;
+
+    /**
+     * @brief Runs the deferred stages, one per event loop iteration.
+     */
+    static void runStages();
+
+    /**
+     * @brief Prints the timings if requested by the environment.
+     */
+    static void report();
+
+    /**
+     * @brief Times opening empty windows if requested by the environment.
+     */
+    static void benchmark();
+};
@@ -1,33 +1,60 @@
 #include "StatusBar.h"
 #include "MainWindow.h"
+#include "LargeWindow.h"
 #include "Editor.h"
 #include "Attr.h"
 
+#include <QLocale>
+
 StatusBar::StatusBar(MainWindow *win) : QStatusBar(win), win(win) {
-    // Hide the size grip on the bottom right corner
-    setSizeGripEnabled(false);
+    makeLabels();
 
-    posLabel = new QLabel(this);
     updateCursorPos();
     // Update the cursor position on typing
     connect(win->getEditor(), &Editor::cursorPositionChanged,
             this, &StatusBar::updateCursorPos);
+    updateMemory();
+}
+
+StatusBar::StatusBar(LargeWindow *win) : QStatusBar(win), win(nullptr) {
+    makeLabels();
+}
+
+void StatusBar::makeLabels() {
+    // Hide the size grip on the bottom right corner
+    setSizeGripEnabled(false);
+
+    posLabel = new QLabel(this);
     addPermanentWidget(posLabel);
 
     zoomLabel = new QLabel(this);
     updateZoom();
     addPermanentWidget(zoomLabel);
+
+    memoryLabel = new QLabel(this);
+    memoryLabel->setToolTip(tr("Estimated memory used by this document"));
+    addPermanentWidget(memoryLabel);
 }
 
 void StatusBar::updateCursorPos() {
-    const QTextCursor &cursor = win->getEditor()->textCursor();
-    // Current line
-    int ln = cursor.blockNumber() + 1;
-    // Current column
-    int col = cursor.columnNumber() + 1;
-    posLabel->setText(tr("Ln %0, Col %1").arg(ln).arg(col));
+    // Current line and column in the file, even inside a long line
+    int ln, col;
+    win->getEditor()->cursorPos(ln, col);
+    showCursorPos(ln, col);
+}
+
+void StatusBar::showCursorPos(qint64 line, qint64 column) {
+    posLabel->setText(tr("Ln %0, Col %1").arg(line).arg(column));
 }
 
 void StatusBar::updateZoom() {
     zoomLabel->setText(QString::number(Attr::get().zoom) + "%");
 }
+
+void StatusBar::updateMemory() {
+    showMemory(win->memoryUsage());
+}
+
+void StatusBar::showMemory(qint64 bytes) {
+    memoryLabel->setText(QLocale{}.formattedDataSize(bytes));
+}
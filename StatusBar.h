@@ -5,6 +5,7 @@
 
 // Forward declarations
 class MainWindow;
+class LargeWindow;
 
 /**
  * @brief Displays the editor status.
@@ -19,21 +20,53 @@ public:
      */
     StatusBar(MainWindow *win);
 
+    /**
+     * @brief Initializes a new 'StatusBar' instance, which the window
+     * keeps up to date itself.
+     * @param win The parent 'LargeWindow' instance.
+     */
+    StatusBar(LargeWindow *win);
+
     /**
      * @brief Updates the cursor position.
      */
     void updateCursorPos();
 
+    /**
+     * @brief Displays a cursor position.
+     * @param line The line, starting from 1.
+     * @param column The column, starting from 1.
+     */
+    void showCursorPos(qint64 line, qint64 column);
+
     /**
      * @brief Updates the zoom percentage of the editor font size.
      */
     void updateZoom();
 
+    /**
+     * @brief Updates the memory used by the document.
+     */
+    void updateMemory();
+
+    /**
+     * @brief Displays the memory used by the document.
+     * @param bytes The number of bytes.
+     */
+    void showMemory(qint64 bytes);
+
 private:
-    MainWindow *win;
+    MainWindow *win;    // The window to update from, or nullptr
 
     // Display the text cursor position
     QLabel *posLabel;
     // Display the zoom percentage
     QLabel *zoomLabel;
+    // Display the memory used by the document
+    QLabel *memoryLabel;
+
+    /**
+     * @brief Creates the labels.
+     */
+    void makeLabels();
 };
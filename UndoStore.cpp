@@ -0,0 +1,161 @@
+#include "UndoStore.h"
+#include "Editor.h"
+#include "FileUtil.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextCursor>
+#include <QTextDocument>
+
+// Version of the stored format
+static constexpr quint32 STORE_VERSION = 1;
+// Maximum size of the recorded deltas, in bytes before compression
+static constexpr qint64 MAX_SIZE = 4 * 1024 * 1024;
+
+/**
+ * @brief Replaces a range of text, as reported by 'contentsChange'.
+ */
+struct Delta {
+    qint32 pos;
+    qint32 removed;
+    QString added;
+};
+
+// A group of deltas that is undone or redone as one step
+using Step = QList<Delta>;
+
+static QDataStream &operator<<(QDataStream &out, const Delta &delta) {
+    return out << delta.pos << delta.removed << delta.added;
+}
+
+static QDataStream &operator>>(QDataStream &in, Delta &delta) {
+    return in >> delta.pos >> delta.removed >> delta.added;
+}
+
+/**
+ * @brief Computes the hash that identifies the document content.
+ * @param doc The document.
+ * @return The content hash.
+ */
+static QByteArray contentHash(const QTextDocument *doc) {
+    return QCryptographicHash::hash(doc->toPlainText().toUtf8(),
+                                    QCryptographicHash::Sha1);
+}
+
+/**
+ * @brief Applies a step to the document as a single edit.
+ * @param doc The document.
+ * @param step The step to apply.
+ */
+static void apply(QTextDocument *doc, const Step &step) {
+    QTextCursor cursor{doc};
+    cursor.beginEditBlock();
+    for (const auto &delta : step) {
+        const int last = doc->characterCount() - 1;
+        cursor.setPosition(qMin(delta.pos, last));
+        cursor.setPosition(qMin(delta.pos + delta.removed, last), QTextCursor::KeepAnchor);
+        cursor.insertText(delta.added);
+    }
+    cursor.endEditBlock();
+}
+
+void UndoStore::save(QTextDocument *doc, const QString &path) {
+    if (!doc->isUndoAvailable()) {
+        return;
+    }
+
+    const QByteArray &hash = contentHash(doc);
+
+    // Record every change made while walking through the history
+    QList<Step> undoSteps, redoSteps;
+    QList<Step> *steps = &undoSteps;
+    qint64 size = 0;
+    const auto connection = QObject::connect(
+        doc, &QTextDocument::contentsChange, doc,
+        [doc, &steps, &size] (int pos, int removed, int added) {
+        const QString &text = Editor::plainText(doc, pos, pos + added);
+        steps->last().append({pos, removed, text});
+        size += text.size() * 2 + 8;
+    });
+
+    // Walk back until the oldest step, or until the size cap is reached
+    while (doc->isUndoAvailable() && size < MAX_SIZE) {
+        undoSteps.append({});
+        doc->undo();
+    }
+
+    // Walk forward again, recording how to redo each step
+    steps = &redoSteps;
+    for (qsizetype i = 0; i < undoSteps.size(); ++i) {
+        redoSteps.append({});
+        doc->redo();
+    }
+    QObject::disconnect(connection);
+
+    QByteArray bytes;
+    QDataStream out{&bytes, QIODevice::WriteOnly};
+    out.setVersion(QDataStream::Qt_6_0);
+    out << STORE_VERSION << hash << undoSteps << redoSteps;
+
+    QSaveFile file{storePath(path)};
+    if (file.open(QFile::WriteOnly)) {
+        file.write(qCompress(bytes));
+        file.commit();
+    }
+}
+
+bool UndoStore::exists(const QString &path) {
+    return !path.isEmpty() && QFile::exists(storePath(path));
+}
+
+bool UndoStore::restore(QTextDocument *doc, const QString &path) {
+    if (!exists(path)) {
+        return false;
+    }
+
+    QFile file{storePath(path)};
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+    const QByteArray &bytes = qUncompress(file.readAll());
+    file.close();
+
+    QDataStream in{bytes};
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 version;
+    QByteArray hash;
+    QList<Step> undoSteps, redoSteps;
+    in >> version >> hash >> undoSteps >> redoSteps;
+
+    // The history only applies to the content it was recorded with
+    if (in.status() != QDataStream::Ok || version != STORE_VERSION ||
+        undoSteps.size() != redoSteps.size() || hash != contentHash(doc)) {
+        QFile::remove(storePath(path));
+        return false;
+    }
+
+    // Go back to the oldest state without recording anything
+    doc->setUndoRedoEnabled(false);
+    for (const auto &step : std::as_const(undoSteps)) {
+        apply(doc, step);
+    }
+    doc->setUndoRedoEnabled(true);
+
+    // Then redo every step, which rebuilds the undo stack
+    for (const auto &step : std::as_const(redoSteps)) {
+        apply(doc, step);
+    }
+    doc->setModified(false);
+
+    // The history now lives in the document again
+    QFile::remove(storePath(path));
+    return true;
+}
+
+QString UndoStore::storePath(const QString &path) {
+    const QByteArray &key =
+        QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return FileUtil::dataDir("undo") + "/" + QString::fromLatin1(key) + ".undo";
+}
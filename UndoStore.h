@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QString>
+
+// Forward declarations
+class QTextDocument;
+
+/**
+ * @brief Keeps the undo history of files between sessions.
+ * @note The history is stored as a compact list of deltas, keyed by the
+ * file path and a hash of the content, so it is only applied to the same
+ * unchanged file.
+ */
+class UndoStore {
+public:
+    /**
+     * @brief Stores the undo history of a document.
+     * @note The document is undone and redone to read its history,
+     * so this should only be called when its window is closing.
+     * @param doc The document, matching the file on disk.
+     * @param path The full file path.
+     */
+    static void save(QTextDocument *doc, const QString &path);
+
+    /**
+     * @brief Checks whether an undo history is stored for a file.
+     * @param path The full file path.
+     * @return true if a history is stored; false otherwise.
+     */
+    static bool exists(const QString &path);
+
+    /**
+     * @brief Loads the stored undo history into a document.
+     * @note The history is only applied if the content is unchanged.
+     * @param doc The document, without any undo history.
+     * @param path The full file path.
+     * @return true if the history is restored; false otherwise.
+     */
+    static bool restore(QTextDocument *doc, const QString &path);
+
+private:
+    UndoStore() = delete;   // Prevent instantiation
+
+    /**
+     * @brief Provides the location of the history of a file.
+     * @param path The full file path.
+     * @return The path of the stored history.
+     */
+    static QString storePath(const QString &path);
+};